@@ -0,0 +1,489 @@
+#include "bench.hpp"
+#include "engine.hpp"
+#include "evaluation.hpp"
+#include "nnue.hpp"
+#include "sliders.hpp"
+#include "transposition.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <random>
+#include <thread>
+
+namespace chess {
+
+const std::vector<std::string> Benchmark::replayGame = {
+    "e2e4", "e7e5", "g1f3", "b8c6", "f1b5", "a7a6", "b5a4", "g8f6", "e1g1", "f8e7",
+    "f1e1", "b7b5", "a4b3", "d7d6", "c2c3", "e8g8", "h2h3", "c6a5", "b3c2", "c7c5",
+    "d2d4", "d8c7", "b1d2", "c5d4", "c3d4", "a5c6", "d2b3", "a6a5", "c1e3", "a5a4"
+};
+
+const std::vector<std::string> Benchmark::positions = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r1bqkb1r/pp1n1ppp/2n1p3/2ppP3/3P1P2/2N2N2/PPP3PP/R1BQKB1R w KQkq - 1 7",
+    "r1bq1rk1/pp2nppp/2n1p3/2ppP3/3P4/P1PB1N2/2P2PPP/R1BQK2R w KQ - 1 9",
+    "r2q1rk1/pp2ppbp/2p2np1/6B1/3PP1b1/Q1P2N2/P4PPP/3RKB1R b K - 0 13",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"
+};
+
+namespace {
+
+uint64_t evaluationWalk(Board& board, Evaluation& evaluation, int depth, int64_t& checksum) {
+    checksum += evaluation.evaluate(board);
+    if (depth == 0) return 1;
+
+    uint64_t nodes = 1;
+    Movelist moves;
+    movegen::legalmoves(moves, board);
+    for (const Move& move : moves) {
+        evaluation.makeMove(board, move);
+        board.makeMove(move);
+        nodes += evaluationWalk(board, evaluation, depth - 1, checksum);
+        board.unmakeMove(move);
+        evaluation.unmakeMove();
+    }
+    return nodes;
+}
+
+// Captures-only search with a stand-pat score, the node type lazy evaluation is aimed at
+int quiescence(Board& board, Evaluation& evaluation, int alpha, int beta, bool lazy, uint64_t& nodes) {
+    nodes++;
+    int standPat = lazy ? evaluation.evaluate(board, alpha, beta) : evaluation.evaluate(board);
+    if (standPat >= beta) return standPat;
+    alpha = std::max(alpha, standPat);
+
+    Movelist captures;
+    movegen::legalmoves<movegen::MoveGenType::CAPTURE>(captures, board);
+    for (const Move& move : captures) {
+        evaluation.makeMove(board, move);
+        board.makeMove(move);
+        int score = -quiescence(board, evaluation, -beta, -alpha, lazy, nodes);
+        board.unmakeMove(move);
+        evaluation.unmakeMove();
+        if (score >= beta) return score;
+        alpha = std::max(alpha, score);
+    }
+    return alpha;
+}
+
+int alphaBeta(Board& board, Evaluation& evaluation, int depth, int alpha, int beta, bool lazy, uint64_t& nodes) {
+    if (depth == 0) return quiescence(board, evaluation, alpha, beta, lazy, nodes);
+    nodes++;
+
+    Movelist moves;
+    movegen::legalmoves(moves, board);
+    if (moves.empty()) return board.inCheck() ? -100000 : 0;
+    for (const Move& move : moves) {
+        evaluation.makeMove(board, move);
+        board.makeMove(move);
+        int score = -alphaBeta(board, evaluation, depth - 1, -beta, -alpha, lazy, nodes);
+        board.unmakeMove(move);
+        evaluation.unmakeMove();
+        if (score >= beta) return score;
+        alpha = std::max(alpha, score);
+    }
+    return alpha;
+}
+
+} // namespace
+
+void Benchmark::run(const std::string& section, int depth, size_t hashSizeMb, int threads) {
+    if (section.empty() || section == "ttd") {
+        timeToDepth(depth, hashSizeMb);
+    }
+    if (section.empty() || section == "hashsize") {
+        hashFootprint();
+    }
+    if (section.empty() || section == "prefetch") {
+        hashPrefetch();
+    }
+    if (section.empty() || section == "hashinit") {
+        hashInit(threads);
+    }
+    if (section.empty() || section == "eval") {
+        evaluation();
+    }
+    if (section.empty() || section == "nnue") {
+        nnue();
+    }
+    if (section.empty() || section == "lazy") {
+        // Without move ordering the tree grows too fast for the usual bench depth
+        lazyEvaluation(std::min(depth, 2));
+    }
+    if (section.empty() || section == "pawns") {
+        pawnStructure();
+    }
+    if (section.empty() || section == "sliders") {
+        sliders();
+    }
+    if (section.empty() || section == "smp") {
+        smpScaling(depth, hashSizeMb);
+    }
+}
+
+void Benchmark::timeToDepth(int depth, size_t hashSizeMb) {
+    using clock = std::chrono::steady_clock;
+
+    Board board;
+    Engine engine(depth, board, hashSizeMb);
+    double totalMs = 0;
+    uint64_t totalNodes = 0;
+
+    for (size_t ply = 0; ply < replayGame.size(); ply++) {
+        auto start = clock::now();
+        engine.getMove(board);
+        double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+        totalMs += ms;
+        totalNodes += engine.nodes();
+
+        std::cout << "info string bench ttd ply " << ply + 1 << " depth " << depth
+                  << " nodes " << engine.nodes()
+                  << " time " << std::fixed << std::setprecision(1) << ms << " ms" << std::endl;
+
+        board.makeMove(uci::uciToMove(board, replayGame[ply]));
+    }
+
+    std::cout << "info string bench ttd positions " << replayGame.size() << " depth " << depth
+              << " hash " << hashSizeMb << " nodes " << totalNodes
+              << " nps " << static_cast<uint64_t>(totalMs > 0 ? totalNodes * 1000.0 / totalMs : 0)
+              << " total " << std::fixed << std::setprecision(1) << totalMs
+              << " ms average " << totalMs / replayGame.size() << " ms" << std::endl;
+}
+
+void Benchmark::hashFootprint() {
+    // Layout of the entry stored in the original std::unordered_map based table
+    struct LegacyEntry {
+        uint64_t key;
+        int value;
+        uint8_t depth;
+        uint8_t nodeType;
+        Move move;
+    };
+    // Each map node holds the next pointer and the key/entry pair, plus one bucket pointer per element
+    const size_t legacyBytes = sizeof(void*) + sizeof(std::pair<const uint64_t, LegacyEntry>) + sizeof(void*);
+    const size_t mb = 1024 * 1024;
+
+    std::cout << "info string bench hashsize layout unordered_map entry " << sizeof(LegacyEntry)
+              << " bytes node " << legacyBytes << " bytes entries/MB " << mb / legacyBytes << std::endl;
+    std::cout << "info string bench hashsize layout packed entry " << TranspositionTable::entryBytes
+              << " bytes per bucket " << TranspositionTable::entriesPerBucket << " entries/MB "
+              << mb / TranspositionTable::bucketBytes * TranspositionTable::entriesPerBucket << std::endl;
+}
+
+void Benchmark::hashPrefetch() {
+    using clock = std::chrono::steady_clock;
+    const int nodes = 2000000;
+
+    for (size_t sizeMb : {256, 1024}) {
+        TranspositionTable table(sizeMb);
+
+        for (bool usePrefetch : {false, true}) {
+            table.clear();
+
+            // Same random walk for both runs, restarting from the opening whenever a game ends
+            std::mt19937 rng(12345);
+            Board board;
+            Movelist moves;
+            movegen::legalmoves(moves, board);
+            int found = 0;
+
+            auto start = clock::now();
+            for (int node = 0; node < nodes; node++) {
+                if (moves.empty() || board.halfMoveClock() >= 100) {
+                    board = Board();
+                    movegen::legalmoves(moves, board);
+                }
+                board.makeMove(moves[rng() % moves.size()]);
+                uint64_t hash = board.hash();
+                if (usePrefetch) table.prefetch(hash);
+
+                movegen::legalmoves(moves, board);
+                if (table.lookupEvaluation(1, 0, -1, 1, hash) != TranspositionTable::lookupFailed) found++;
+                table.storeEvaluation(1, 0, 0, TranspositionTable::exact,
+                                      moves.empty() ? Move(Move::NO_MOVE) : moves[0], hash);
+            }
+            double seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+            std::cout << "info string bench prefetch hash " << sizeMb << " prefetch " << (usePrefetch ? "on" : "off")
+                      << " nodes " << nodes << " hits " << found
+                      << " nps " << static_cast<uint64_t>(nodes / seconds) << std::endl;
+        }
+    }
+}
+
+void Benchmark::hashInit(int threads) {
+    using clock = std::chrono::steady_clock;
+    int maxThreads = std::max(threads, static_cast<int>(std::thread::hardware_concurrency()));
+    std::vector<int> threadCounts = {1};
+    if (maxThreads > 1) threadCounts.push_back(maxThreads);
+
+    for (size_t sizeMb : {64, 256, 1024}) {
+        for (int clearThreads : threadCounts) {
+            // Only the resize is timed: it is what `setoption name Hash` runs, and construction
+            // would add a single-threaded clear of the smaller table
+            TranspositionTable table(sizeMb / 2);
+            auto start = clock::now();
+            table.resize(sizeMb, clearThreads);
+            double initMs = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+            start = clock::now();
+            table.clear(clearThreads);
+            double clearMs = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+            std::cout << "info string bench hashinit hash " << sizeMb << " threads " << clearThreads
+                      << " hugepages " << (table.usesHugePages() ? "yes" : "no")
+                      << " init " << std::fixed << std::setprecision(1) << initMs << " ms"
+                      << " clear " << clearMs << " ms" << std::endl;
+        }
+    }
+}
+
+void Benchmark::evaluation() {
+    using clock = std::chrono::steady_clock;
+    const int walkDepth = 3;
+    double baselineNps = 0;
+
+    for (bool useEvalCache : {false, true}) {
+        Evaluation evaluation;
+        evaluation.useEvalCache = useEvalCache;
+        uint64_t nodes = 0;
+        int64_t checksum = 0;
+
+        auto start = clock::now();
+        for (const std::string& fen : positions) {
+            Board board(fen);
+            evaluation.setPosition(board);
+            nodes += evaluationWalk(board, evaluation, walkDepth, checksum);
+        }
+        double seconds = std::chrono::duration<double>(clock::now() - start).count();
+        double nps = nodes / seconds;
+        if (!useEvalCache) baselineNps = nps;
+
+        auto rate = [](uint64_t hits, uint64_t probes) { return probes ? 100.0 * hits / probes : 0.0; };
+        const PawnHashTable& pawns = evaluation.pawnTable;
+        std::cout << "info string bench eval evalcache " << (useEvalCache ? "on" : "off")
+                  << " nodes " << nodes << " nps " << static_cast<uint64_t>(nps)
+                  << std::fixed << std::setprecision(1)
+                  << " delta " << (baselineNps ? 100.0 * (nps - baselineNps) / baselineNps : 0.0) << "%"
+                  << " evalcache hits " << rate(evaluation.evalCacheHits, evaluation.evalCacheProbes) << "%"
+                  << " pawnhash hits " << rate(pawns.hits, pawns.probes) << "%"
+                  << " checksum " << checksum << std::endl;
+    }
+}
+
+void Benchmark::nnue() {
+    using clock = std::chrono::steady_clock;
+    const int walkDepth = 3;
+    const bool useNnue = Evaluation::useNnue;
+    const std::string bestKernel = Nnue::kernel();
+
+    // Inference cost does not depend on the weights, so a random network is fine for timing
+    const bool randomNetwork = !Nnue::loaded();
+    if (randomNetwork) Nnue::loadRandom(12345);
+
+    // Handcrafted evaluation first as the baseline, then the network with each kernel
+    std::vector<std::string> backends = {"handcrafted"};
+    for (const std::string& kernel : Nnue::kernelNames()) backends.push_back(kernel);
+    double baselineNps = 0;
+
+    for (const std::string& backend : backends) {
+        Evaluation::useNnue = backend != "handcrafted";
+        if (Evaluation::useNnue) Nnue::useKernel(backend);
+
+        Evaluation evaluation;
+        evaluation.useEvalCache = false;
+        uint64_t nodes = 0;
+        int64_t checksum = 0;
+
+        auto start = clock::now();
+        for (const std::string& fen : positions) {
+            Board board(fen);
+            evaluation.setPosition(board);
+            nodes += evaluationWalk(board, evaluation, walkDepth, checksum);
+        }
+        double seconds = std::chrono::duration<double>(clock::now() - start).count();
+        double nps = nodes / seconds;
+        if (!Evaluation::useNnue) baselineNps = nps;
+
+        std::cout << "info string bench nnue eval "
+                  << (Evaluation::useNnue ? "nnue kernel " + backend + " network " + Nnue::fileName() : backend)
+                  << " nodes " << nodes << " nps " << static_cast<uint64_t>(nps)
+                  << std::fixed << std::setprecision(1)
+                  << " delta " << 100.0 * (nps - baselineNps) / baselineNps << "%"
+                  << " checksum " << checksum << std::endl;
+    }
+
+    Evaluation::useNnue = useNnue;
+    Nnue::useKernel(bestKernel);
+    if (randomNetwork) Nnue::unload();
+}
+
+void Benchmark::lazyEvaluation(int depth) {
+    using clock = std::chrono::steady_clock;
+    const int defaultMargin = Evaluation::lazyMargin;
+    double baselineNps = 0;
+
+    // Zero stands for lazy evaluation switched off
+    for (int margin : {0, 400, defaultMargin, 150}) {
+        const bool lazy = margin > 0;
+        if (lazy) Evaluation::lazyMargin = margin;
+
+        Evaluation evaluation;
+        uint64_t nodes = 0;
+        int64_t checksum = 0;
+
+        auto start = clock::now();
+        for (const std::string& fen : positions) {
+            Board board(fen);
+            evaluation.setPosition(board);
+            checksum += alphaBeta(board, evaluation, depth, -1000000, 1000000, lazy, nodes);
+        }
+        double seconds = std::chrono::duration<double>(clock::now() - start).count();
+        double nps = nodes / seconds;
+        if (!lazy) baselineNps = nps;
+
+        std::cout << "info string bench lazy depth " << depth << " margin "
+                  << (lazy ? std::to_string(margin) : std::string("off"))
+                  << " nodes " << nodes << " nps " << static_cast<uint64_t>(nps)
+                  << std::fixed << std::setprecision(1)
+                  << " delta " << 100.0 * (nps - baselineNps) / baselineNps << "%"
+                  << " exits " << (evaluation.lazyProbes ? 100.0 * evaluation.lazyExits / evaluation.lazyProbes : 0.0) << "%"
+                  << " time " << seconds * 1000 << " ms checksum " << checksum << std::endl;
+    }
+
+    Evaluation::lazyMargin = defaultMargin;
+}
+
+void Benchmark::pawnStructure() {
+    using clock = std::chrono::steady_clock;
+    const int iterations = 200000;
+
+    std::vector<Board> boards;
+    for (const std::string& fen : positions) boards.emplace_back(fen);
+
+    int64_t checksum = 0;
+    auto start = clock::now();
+    for (int i = 0; i < iterations; i++) {
+        for (const Board& board : boards) {
+            checksum += PawnHashTable::evaluatePawns(board).score;
+        }
+    }
+    double seconds = std::chrono::duration<double>(clock::now() - start).count();
+    double calls = static_cast<double>(iterations) * boards.size();
+    double ns = seconds * 1e9 / calls;
+
+    std::cout << "info string bench pawns calls " << static_cast<uint64_t>(calls)
+              << std::fixed << std::setprecision(1) << " ns/call " << ns
+              << " budget " << pawnEvalBudgetNs << " ns " << (ns <= pawnEvalBudgetNs ? "ok" : "over")
+              << " checksum " << checksum << std::endl;
+}
+
+void Benchmark::sliders() {
+    using clock = std::chrono::steady_clock;
+    const int walkDepth = 3;
+    const int lookupRounds = 16;
+    const std::string bestBackend = Sliders::backend();
+
+    // Alternately sparse and dense occupancies, roughly the range seen in real positions
+    std::mt19937_64 rng(12345);
+    std::vector<Bitboard> occupancies(1 << 16);
+    for (size_t i = 0; i < occupancies.size(); i++) {
+        occupancies[i] = Bitboard(i % 2 ? rng() & rng() : rng() & rng() & rng());
+    }
+
+    // Magic first, as the baseline the faster backends are compared against
+    std::vector<std::string> backends = Sliders::backendNames();
+    std::reverse(backends.begin(), backends.end());
+
+    double baselineNps = 0;
+    for (const std::string& backend : backends) {
+        Sliders::useBackend(backend);
+
+        // Every lookup is checked against chess::attacks, which always uses magics
+        uint64_t mismatches = 0;
+        for (Bitboard occupied : occupancies) {
+            for (int square = 0; square < 64; square++) {
+                mismatches += Sliders::bishop(Square(square), occupied) != attacks::bishop(Square(square), occupied);
+                mismatches += Sliders::rook(Square(square), occupied) != attacks::rook(Square(square), occupied);
+            }
+        }
+
+        uint64_t lookupChecksum = 0;
+        auto start = clock::now();
+        for (int round = 0; round < lookupRounds; round++) {
+            for (Bitboard occupied : occupancies) {
+                for (int square = 0; square < 64; square++) {
+                    lookupChecksum += Sliders::queen(Square(square), occupied).getBits();
+                }
+            }
+        }
+        double lookupSeconds = std::chrono::duration<double>(clock::now() - start).count();
+        double lookups = 2.0 * lookupRounds * occupancies.size() * 64;
+
+        // Mobility and king safety are the engine's slider lookups
+        Evaluation evaluation;
+        evaluation.useEvalCache = false;
+        uint64_t nodes = 0;
+        int64_t checksum = 0;
+        start = clock::now();
+        for (const std::string& fen : positions) {
+            Board board(fen);
+            evaluation.setPosition(board);
+            nodes += evaluationWalk(board, evaluation, walkDepth, checksum);
+        }
+        double seconds = std::chrono::duration<double>(clock::now() - start).count();
+        double nps = nodes / seconds;
+        if (baselineNps == 0) baselineNps = nps;
+
+        std::cout << "info string bench sliders backend " << backend
+                  << " mismatches " << mismatches
+                  << std::fixed << std::setprecision(1)
+                  << " ns/lookup " << lookupSeconds * 1e9 / lookups
+                  << " eval nodes " << nodes << " nps " << static_cast<uint64_t>(nps)
+                  << " delta " << 100.0 * (nps - baselineNps) / baselineNps << "%"
+                  << " checksum " << (checksum ^ static_cast<int64_t>(lookupChecksum)) << std::endl;
+    }
+
+    Sliders::useBackend(bestBackend);
+}
+
+void Benchmark::smpScaling(int depth, size_t hashSizeMb) {
+    using clock = std::chrono::steady_clock;
+    double baselineMs = 0;
+    double baselineNps = 0;
+
+    for (int threads : {1, 2, 4, 8, 16}) {
+        // A fresh engine per thread count so every run starts from an empty table
+        Board board;
+        Engine engine(depth, board, hashSizeMb);
+        engine.setThreads(threads);
+        double totalMs = 0;
+        uint64_t totalNodes = 0;
+
+        for (const std::string& move : replayGame) {
+            auto start = clock::now();
+            engine.getMove(board);
+            totalMs += std::chrono::duration<double, std::milli>(clock::now() - start).count();
+            totalNodes += engine.nodes();
+            board.makeMove(uci::uciToMove(board, move));
+        }
+
+        double nps = totalNodes * 1000.0 / totalMs;
+        if (threads == 1) {
+            baselineMs = totalMs;
+            baselineNps = nps;
+        }
+
+        std::cout << "info string bench smp threads " << threads << " depth " << depth
+                  << " nodes " << totalNodes << " nps " << static_cast<uint64_t>(nps)
+                  << std::fixed << std::setprecision(2)
+                  << " nps scaling " << nps / baselineNps
+                  << " time " << std::setprecision(1) << totalMs << " ms"
+                  << " ttd speedup " << std::setprecision(2) << baselineMs / totalMs << std::endl;
+    }
+}
+
+} // namespace chess
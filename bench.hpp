@@ -0,0 +1,104 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace chess {
+
+class Benchmark {
+public:
+    /**
+     * Runs the benchmark selected by the `bench` UCI command
+     * @param section Which benchmark to run, empty runs all of them
+     * @param depth Search depth used by the search benchmarks
+     * @param hashSizeMb Transposition table size in MB
+     * @param threads Number of threads from the Threads option
+     */
+    static void run(const std::string& section, int depth, size_t hashSizeMb, int threads);
+
+    /**
+     * Replays a fixed game through the engine and reports the time taken to
+     * reach the given depth at every position, keeping the TT between moves
+     */
+    static void timeToDepth(int depth, size_t hashSizeMb);
+
+    /**
+     * Prints the bytes per entry and entries per MB of the original
+     * unordered_map transposition table next to the packed bucket layout
+     */
+    static void hashFootprint();
+
+    /**
+     * Measures nodes per second of a TT-heavy random walk (make move, generate
+     * moves, probe and store) with and without prefetching the child's bucket,
+     * at 256 MB and 1 GB so most probes miss the cache
+     */
+    static void hashPrefetch();
+
+    /**
+     * Reports how long `setoption name Hash` plus `isready` takes for large
+     * tables: allocation plus zeroing with one thread and with all threads
+     * @param threads Thread count used for the parallel clear
+     */
+    static void hashInit(int threads);
+
+    /**
+     * Walks every line to a fixed depth from the bench positions, evaluating
+     * each node with incremental updates on make/unmake, and reports
+     * evaluations per second together with the evaluator's cache hit rates
+     */
+    static void evaluation();
+
+    /**
+     * Repeats the evaluation walk with the handcrafted evaluation and with the
+     * network under every inference kernel the CPU supports, reporting the NPS
+     * cost of NNUE. Uses a random network when no EvalFile is loaded.
+     */
+    static void nnue();
+
+    /**
+     * Runs a shallow alpha-beta search ending in a captures-only quiescence
+     * search from every bench position, with full evaluation at each node and
+     * then with lazy evaluation at a few margins, reporting NPS and how often
+     * the lazy evaluation exits early
+     * @param depth Full-width depth before quiescence
+     */
+    static void lazyEvaluation(int depth);
+
+    /**
+     * Times uncached pawn structure evaluation over the bench positions and
+     * checks the cost per call against pawnEvalBudgetNs
+     */
+    static void pawnStructure();
+
+    /**
+     * Checks every slider attack backend the CPU supports against chess::attacks
+     * on random occupancies, then reports the cost per lookup and the NPS of the
+     * evaluation walk, whose mobility term is the engine's slider lookups
+     */
+    static void sliders();
+
+    /**
+     * Replays the bench game with 1, 2, 4, 8 and 16 Lazy SMP threads, reporting
+     * total NPS and time to depth relative to a single thread
+     * @param depth Search depth of the main thread
+     * @param hashSizeMb Transposition table size in MB
+     */
+    static void smpScaling(int depth, size_t hashSizeMb);
+
+    // Pawn structure is only evaluated on a pawn hash miss, but it must stay cheap
+    // enough that a miss costs about as much as the rest of the evaluation
+    static constexpr double pawnEvalBudgetNs = 50.0;
+
+    // Opening moves of the game replayed by the search benchmarks, in UCI notation
+    static const std::vector<std::string> replayGame;
+
+    // Mix of openings, pawn-heavy middlegames and endgames
+    static const std::vector<std::string> positions;
+};
+
+} // namespace chess
+
+#endif // BENCH_HPP
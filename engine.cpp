@@ -1,32 +1,193 @@
 #include "engine.hpp"
+#include <algorithm>
+#include <thread>
 using namespace chess;
 using namespace std;
 
-Engine::Engine(int maxDepth, Board board) 
+Engine::Engine(int maxDepth, Board board, size_t hashSizeMb) 
     : maxDepth_(maxDepth), 
       board_(board), 
-      transposition_(256000), 
-      search_(board, AISettings{maxDepth}) 
+      transposition_(hashSizeMb), 
+      search_(board, AISettings{maxDepth}, transposition_) 
 {
     search_.settings.useIterativeDeepening = true;
     search_.settings.depth = maxDepth; 
+    // Info lines come from the main search but count the helpers' nodes too
+    search_.setNodeCounter([this]() { return nodes(); });
+    startWorkers();
 }
 
 void Engine::setPosition(Board board) {
     board_ = board;
 }
 
+void Engine::setHashSize(size_t hashSizeMb) {
+    // The table must not be reallocated under a running search
+    stop();
+    wait();
+    transposition_.resize(hashSizeMb, threads_);
+}
+
+void Engine::setThreads(int threads) {
+    threads_ = std::max(1, threads);
+    stopWorkers();
+    helpers_.resize(std::min(helpers_.size(), static_cast<size_t>(threads_ - 1)));
+    // Skip schedules for the helpers in order, repeating after 20: the first two alternate odd and
+    // even depths, the next four search two depths in every four, and so on
+    static const int skipSizes[20] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+    static const int skipPhases[20] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+    while (helpers_.size() < static_cast<size_t>(threads_ - 1)) {
+        // Helpers aim one ply past the main search and skip depths on the way, so they are
+        // usually an iteration ahead of it and of each other, filling the table for it
+        AISettings settings{maxDepth_ + 1};
+        settings.useIterativeDeepening = true;
+        settings.printInfo = false;
+        settings.skipSize = skipSizes[helpers_.size() % 20];
+        settings.skipPhase = skipPhases[helpers_.size() % 20];
+        helpers_.push_back(std::make_unique<Search>(board_, settings, transposition_));
+    }
+    startWorkers();
+}
+
+void Engine::stop() {
+    search_.stop();
+    for (auto& helper : helpers_) helper->stop();
+}
+
+void Engine::newGame() {
+    // The clear would race with the stores of a search still running
+    stop();
+    wait();
+    transposition_.clear(threads_);
+}
+
+bool Engine::saveHash(const std::string& path) const {
+    return transposition_.save(path);
+}
+
+bool Engine::loadHash(const std::string& path) {
+    // Loading replaces the bucket array the search threads probe
+    stop();
+    wait();
+    return transposition_.load(path);
+}
+
+uint64_t Engine::nodes() const {
+    uint64_t total = search_.nodes();
+    for (const auto& helper : helpers_) total += helper->nodes();
+    return total;
+}
+
+size_t Engine::hashSizeMb() const {
+    return transposition_.sizeMb();
+}
+
+Engine::~Engine() {
+    stop();
+    stopWorkers();
+}
+
+void Engine::startWorkers() {
+    for (size_t index = 0; index <= helpers_.size(); index++) {
+        workers_.emplace_back(&Engine::workerLoop, this, index, searchId_);
+    }
+}
+
+void Engine::stopWorkers() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) worker.join();
+    workers_.clear();
+    quit_ = false;
+}
+
+void Engine::workerLoop(size_t index, uint64_t searchId) {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&]() { return quit_ || searchId_ != searchId; });
+            if (quit_) return;
+            searchId = searchId_;
+        }
+
+        if (index > 0) {
+            helpers_[index - 1]->startSearch(board_);
+            std::lock_guard<std::mutex> lock(mutex_);
+            helpersRunning_--;
+            done_.notify_all();
+            continue;
+        }
+
+        report_(runSearch());
+        std::lock_guard<std::mutex> lock(mutex_);
+        searching_ = false;
+        done_.notify_all();
+    }
+}
+
 chess::Move Engine::getMove(Board board) {
+    Move bestMove = Move::NO_MOVE;
+    go(board, [&bestMove](Move move) { bestMove = move; });
+    wait();
+    return bestMove;
+}
+
+void Engine::go(Board board, std::function<void(Move)> report) {
+    wait();
+    prepareSearch(board);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        report_ = std::move(report);
+        helpersRunning_ = helpers_.size();
+        searching_ = true;
+        searchId_++;
+    }
+    wake_.notify_all();
+}
+
+void Engine::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return !searching_; });
+}
+
+void Engine::prepareSearch(Board board) {
     board_ = board;
     team_ = board_.sideToMove();
+    transposition_.newSearch();
+    search_.reset();
+    for (auto& helper : helpers_) helper->reset();
+}
+
+chess::Move Engine::runSearch() {
     cout << "Maximising score for " << team_ << endl;
 
     cout << "Starting search..." << endl;
     search_.startSearch(board_); 
-    auto [bestMove, bestEval] = search_.getSearchResult(); 
 
-    cout << "Best move: " << chess::uci::moveToSan(board_, bestMove) 
-              << " Eval: " << bestEval << endl;
+    // The main search decides when to stop. The result comes from the thread with the deepest
+    // completed iteration, and from the main search on a tie, as its info lines showed that PV
+    for (auto& helper : helpers_) helper->stop();
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this]() { return helpersRunning_ == 0; });
+    }
+
+    const Search* best = &search_;
+    for (auto& helper : helpers_) {
+        if (helper->completedDepth() > best->completedDepth()) best = helper.get();
+    }
+    auto [bestMove, bestEval] = best->getSearchResult(); 
+
+    if (bestMove == Move::NO_MOVE) {
+        cout << "No legal moves, Eval: " << bestEval << endl;
+    } else {
+        cout << "Best move: " << chess::uci::moveToSan(board_, bestMove) 
+                  << " Eval: " << bestEval << endl;
+    }
 
     return bestMove; 
 }
@@ -2,6 +2,11 @@
 #define ENGINE_HPP
 
 #include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <random>
 #include <limits>
 #include <iostream>
@@ -13,19 +18,60 @@ namespace chess {
 
 class Engine {
 public:
-    Engine(int maxDepth, Board board);
+    Engine(int maxDepth, Board board, size_t hashSizeMb = 64);
+    ~Engine();
     void setPosition(Board board);
-    Move getMove(Board board);
+    void setHashSize(size_t hashSizeMb); // Stops and waits for a running search first
+    void setThreads(int threads);
+    void stop(); // Ends a running search early, from another thread
+    void newGame(); // Stops and waits for a running search first
+    bool saveHash(const std::string& path) const;
+    bool loadHash(const std::string& path); // Stops and waits for a running search first
+    size_t hashSizeMb() const;
+    const TranspositionTable& transposition() const { return transposition_; }
+    const Search& search() const { return search_; }
+    uint64_t nodes() const; // Nodes searched by the last search over all threads
+    Move getMove(Board board); // Searches and blocks until the best move is known
+    // Starts searching on the engine's threads and returns at once; report is called from the
+    // main search thread with the best move when the search ends. A stop() after go() returns
+    // always reaches it
+    void go(Board board, std::function<void(Move)> report);
+    void wait(); // Blocks until the running search, if any, has reported its move
 
 private:
     int maxDepth_; // Maximum search depth
     Board board_; // Current board state
     Color team_; // The side the engine is playing as
+    int threads_ = 1; // Number of search threads, also used to clear the hash table
     TranspositionTable transposition_; // Transposition table for caching evaluations
     Search search_; // Search object for finding the best move
+    // Lazy SMP: threads_ - 1 helpers search the same root one ply deeper on their own depth
+    // schedules and share transposition_. Their results mostly reach search_ through the table,
+    // but a helper that completes a deeper iteration than search_ supplies the best move.
+    // Kept between moves to reuse their caches
+    std::vector<std::unique_ptr<Search>> helpers_;
 
-    // Old search method (to be removed or replaced)
-    int search(Board& board, int depth, int alpha, int beta);
+    // One persistent thread per search: workers_[0] runs search_ and reports the result, the
+    // rest run helpers_. They sleep between searches, so each search keeps its thread, and with
+    // it the transposition table's per-thread statistics slot, for the engine's lifetime
+    std::vector<std::thread> workers_;
+    std::mutex mutex_; // Guards everything below
+    std::condition_variable wake_; // Signalled when a search starts or the workers must exit
+    std::condition_variable done_; // Signalled when a helper or the whole search finishes
+    uint64_t searchId_ = 0; // Bumped by go(); each worker runs once per new value
+    size_t helpersRunning_ = 0;
+    bool searching_ = false;
+    bool quit_ = false;
+    std::function<void(Move)> report_;
+
+    void startWorkers();
+    void stopWorkers(); // Waits for the running search, then joins every worker
+    void workerLoop(size_t index, uint64_t searchId);
+
+    // Clears every search's stop flag on the thread that starts the search, before any worker
+    // runs, so a stop() sent after the search was started cannot be undone by a worker
+    void prepareSearch(Board board);
+    Move runSearch();
 
     // Evaluation counter (if needed)
     int evaluated_ = 0;
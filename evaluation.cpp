@@ -1,54 +1,363 @@
 #include "evaluation.hpp"
-#include "tables.hpp"
+#include "json.hpp"
 #include "precompute.hpp"
+#include "sliders.hpp"
+#include <algorithm>
+#include <cstring>
 
 namespace chess {
 
-int Evaluation::evaluate(Board board) {
-    this->board = board;
+Evaluation::Evaluation() : evalCache(evalCacheSize, CacheEntry{0, 0}) {
+    states.reserve(256);
+}
+
+bool Evaluation::State::operator==(const State& other) const {
+    for (int color = 0; color < 2; color++) {
+        if (material[color] != other.material[color] || pieceSquares[color] != other.pieceSquares[color]) {
+            return false;
+        }
+    }
+    return pawnKey == other.pawnKey && phase == other.phase;
+}
+
+void Evaluation::setPosition(const Board& board) {
+    states.clear();
+    states.push_back(computeState(board));
+
+    accumulators.clear();
+    if (nnueActive()) {
+        accumulators.reserve(256);
+        accumulators.emplace_back();
+        Nnue::refresh(board, accumulators.back(), WHITE);
+        Nnue::refresh(board, accumulators.back(), BLACK);
+    }
+}
+
+Evaluation::State Evaluation::computeState(const Board& board) {
+    State state;
+    state.pawnKey = PawnHashTable::pawnKey(board);
+    state.phase = countPhase(board);
+    for (int color = 0; color < 2; color++) {
+        state.material[color] = countMaterial(board, color);
+        state.pieceSquares[color] = evaluatePieceSquareTables(board, color);
+    }
+    return state;
+}
+
+void Evaluation::makeMove(const Board& board, Move move) {
+    if (!accumulators.empty()) {
+        accumulators.emplace_back();
+        Nnue::update(board, move, accumulators[accumulators.size() - 2], accumulators.back());
+    }
+
+    State state = states.back();
+    state.pawnKey = PawnHashTable::pawnKeyAfter(state.pawnKey, board, move);
+
+    const int us = board.sideToMove();
+    const int them = us ^ 1;
+    const bool white = us == WHITE;
+    const int from = move.from().index();
+    const int to = move.to().index();
+    const PieceType moved = board.at<PieceType>(move.from());
+
+    if (move.typeOf() == Move::CASTLING) {
+        // The move is encoded as king takes own rook
+        const bool kingSide = move.to() > move.from();
+        const Square kingTo = Square::castling_king_square(kingSide, board.sideToMove());
+        const Square rookTo = Square::castling_rook_square(kingSide, board.sideToMove());
+        state.pieceSquares[us] += pieceSquareScore(PieceType::KING, kingTo.index(), white)
+                                - pieceSquareScore(PieceType::KING, from, white)
+                                + pieceSquareScore(PieceType::ROOK, rookTo.index(), white)
+                                - pieceSquareScore(PieceType::ROOK, to, white);
+        states.push_back(state);
+        return;
+    }
+
+    const int captureSquare = move.typeOf() == Move::ENPASSANT ? to ^ 8 : to;
+    const PieceType captured = board.at<PieceType>(Square(captureSquare));
+    if (captured != PieceType::NONE) {
+        state.material[them] -= pieceValue(captured);
+        state.phase -= piecePhase(captured);
+        state.pieceSquares[them] -= pieceSquareScore(captured, captureSquare, !white);
+    }
+
+    if (move.typeOf() == Move::PROMOTION) {
+        const PieceType promoted = move.promotionType();
+        state.material[us] += pieceValue(promoted) - pawnValue;
+        state.phase += piecePhase(promoted);
+        state.pieceSquares[us] += pieceSquareScore(promoted, to, white)
+                                - pieceSquareScore(PieceType::PAWN, from, white);
+    } else {
+        state.pieceSquares[us] += pieceSquareScore(moved, to, white) - pieceSquareScore(moved, from, white);
+    }
 
-    int whiteEval = 0;
-    int blackEval = 0;
+    states.push_back(state);
+}
 
-    int whiteMaterial = countMaterial(WHITE);
-    int blackMaterial = countMaterial(BLACK);
+void Evaluation::unmakeMove() {
+    states.pop_back();
+    if (!accumulators.empty()) accumulators.pop_back();
+}
 
-    int whiteMaterialWithoutPawns = whiteMaterial - board.pieces(PieceType::PAWN, Color::WHITE).count() * pawnValue;
-    int blackMaterialWithoutPawns = blackMaterial - board.pieces(PieceType::PAWN, Color::BLACK).count() * pawnValue;
-    float whiteEndgamePhaseWeight = endgamePhaseWeight(whiteMaterialWithoutPawns);
-    float blackEndgamePhaseWeight = endgamePhaseWeight(blackMaterialWithoutPawns);
+int Evaluation::evaluate(const Board& board) {
+    if (!useEvalCache) return computeEvaluation(board);
 
-    whiteEval += whiteMaterial;
-    blackEval += blackMaterial;
-    whiteEval += mopUpEval(WHITE, BLACK, whiteMaterial, blackMaterial, blackEndgamePhaseWeight);
-    blackEval += mopUpEval(BLACK, WHITE, blackMaterial, whiteMaterial, whiteEndgamePhaseWeight);
+    // Scores from the two backends differ, so they must not hit on each other's entries
+    const uint64_t key = nnueActive() ? ~board.hash() : board.hash();
+    CacheEntry& entry = evalCache[key & (evalCacheSize - 1)];
+    evalCacheProbes++;
+    if (entry.key == key) {
+        evalCacheHits++;
+        return entry.score;
+    }
+    entry.score = computeEvaluation(board);
+    entry.key = key;
+    return entry.score;
+}
 
-    whiteEval += evaluatePieceSquareTables(WHITE, blackEndgamePhaseWeight);
-    blackEval += evaluatePieceSquareTables(BLACK, whiteEndgamePhaseWeight);
+int Evaluation::evaluate(const Board& board, int alpha, int beta) {
+    // The network has no cheap subset, and a cached full evaluation is both exact and cheap
+    if (nnueActive() || (useEvalCache && evalCache[board.hash() & (evalCacheSize - 1)].key == board.hash())) {
+        return evaluate(board);
+    }
 
+    lazyProbes++;
+    const State state = currentState(board);
+    const Score incremental = evaluateIncremental(board, state);
     int perspective = static_cast<int>(board.sideToMove().internal()) == WHITE ? 1 : -1;
-    int eval = whiteEval - blackEval;
+    int partial = taper(incremental, std::min(state.phase, totalPhase)) * perspective;
+    if (partial + lazyMargin <= alpha || partial - lazyMargin >= beta) {
+        lazyExits++;
+        return partial;
+    }
+
+    NoTrace trace;
+    int eval = computeEvaluation(board, state, incremental, trace);
+    if (useEvalCache) {
+        // Missed above, so this is stored exactly as evaluate(board) would have stored it
+        CacheEntry& entry = evalCache[board.hash() & (evalCacheSize - 1)];
+        evalCacheProbes++;
+        entry.key = board.hash();
+        entry.score = eval;
+    }
+    return eval;
+}
+
+int Evaluation::computeEvaluation(const Board& board) {
+    NoTrace trace;
+    return computeEvaluation(board, trace);
+}
+
+template <typename Trace>
+int Evaluation::computeEvaluation(const Board& board, Trace& trace) {
+    // The trace always explains the handcrafted evaluation
+    if (!Trace::enabled && nnueActive()) return evaluateNnue(board);
+
+    const State state = currentState(board);
+    return computeEvaluation(board, state, evaluateIncremental(board, state), trace);
+}
+
+template <typename Trace>
+int Evaluation::computeEvaluation(const Board& board, const State& state, Score incremental, Trace& trace) {
+    // Promotions can push the phase past the starting position
+    int phase = std::min(state.phase, totalPhase);
+    int pawnStructure = pawnTable.probe(state.pawnKey, board).score;
+
+    int perspective = static_cast<int>(board.sideToMove().internal()) == WHITE ? 1 : -1;
+    int eval = taper(incremental + evaluatePieceActivity(board, trace), phase) + pawnStructure;
+
+    if constexpr (Trace::enabled) {
+        trace.phase = phase;
+        trace.pawnStructure = pawnStructure;
+        trace.total = eval * perspective;
+        for (int color = 0; color < 2; color++) {
+            const int them = color ^ 1;
+            trace.material[color] = state.material[color];
+            trace.mopUp[color] = mopUpEval(board, color, them, state.material[color], state.material[them]);
+            for (int type = 0; type < 6; type++) {
+                const PieceType pieceType = static_cast<PieceType::underlying>(type);
+                const Bitboard pieces = board.pieces(pieceType, color);
+                const int value = pieceValue(pieceType) * pieces.count();
+                trace.pieceSquares[color][type] = evaluatePieceSquareTable(pieceType, pieces, color == WHITE)
+                                                - makeScore(value, value);
+            }
+        }
+    }
     return eval * perspective;
 }
 
-float Evaluation::endgamePhaseWeight(int materialCountWithoutPawns) {
-    return 1 - fmin(1, materialCountWithoutPawns / endgameMaterial);
+template int Evaluation::computeEvaluation<NoTrace>(const Board& board, NoTrace& trace);
+template int Evaluation::computeEvaluation<EvalTrace>(const Board& board, EvalTrace& trace);
+template int Evaluation::computeEvaluation<NoTrace>(const Board& board, const State& state, Score incremental,
+                                                    NoTrace& trace);
+template int Evaluation::computeEvaluation<EvalTrace>(const Board& board, const State& state, Score incremental,
+                                                      EvalTrace& trace);
+
+std::string Evaluation::trace(const Board& board) {
+    EvalTrace trace;
+    computeEvaluation(board, trace);
+
+    auto score = [](Score value) {
+        return nlohmann::json{{"mg", mgValue(value)}, {"eg", egValue(value)}};
+    };
+    static const char* pieceNames[6] = {"pawn", "knight", "bishop", "rook", "queen", "king"};
+
+    nlohmann::json result;
+    result["fen"] = board.getFen();
+    result["sideToMove"] = board.sideToMove() == Color::WHITE ? "white" : "black";
+    result["phase"] = trace.phase;
+    result["endgameWeight"] = static_cast<double>(totalPhase - trace.phase) / totalPhase;
+    for (int color = 0; color < 2; color++) {
+        nlohmann::json side;
+        side["material"] = trace.material[color];
+        for (int type = 0; type < 6; type++) {
+            side["pieceSquares"][pieceNames[type]] = score(trace.pieceSquares[color][type]);
+        }
+        side["mopUp"] = trace.mopUp[color];
+        side["mobility"] = score(trace.mobility[color]);
+        side["kingSafety"] = score(trace.kingSafety[color]);
+        result[color == WHITE ? "white" : "black"] = side;
+    }
+    result["pawnStructure"] = trace.pawnStructure;
+    result["total"] = trace.total;
+    if (nnueActive()) result["nnue"] = computeEvaluation(board);
+    return result.dump();
+}
+
+Evaluation::State Evaluation::currentState(const Board& board) {
+    // Without setPosition() there is no incremental state, so summarise the board from scratch
+    if (states.empty()) return computeState(board);
+
+    if (debugChecks && !(states.back() == computeState(board))) {
+        std::cout << "info string incremental evaluation state out of sync at " << board.getFen() << std::endl;
+        assert(false);
+    }
+    return states.back();
 }
 
-int Evaluation::mopUpEval(int friendlyIndex, int opponentIndex, int friendlyMaterial, int opponentMaterial, float endgameWeight) {
+Score Evaluation::evaluateIncremental(const Board& board, const State& state) {
+    int whiteMaterial = state.material[WHITE];
+    int blackMaterial = state.material[BLACK];
+
+    // Material is folded into the piece-square scores, so it tapers to itself
+    Score pieceSquares = state.pieceSquares[WHITE] - state.pieceSquares[BLACK];
+    Score mopUp = makeScore(0, mopUpEval(board, WHITE, BLACK, whiteMaterial, blackMaterial)
+                             - mopUpEval(board, BLACK, WHITE, blackMaterial, whiteMaterial));
+    return pieceSquares + mopUp;
+}
+
+int Evaluation::evaluateNnue(const Board& board) {
+    Nnue::Accumulator scratch;
+    if (accumulators.empty()) {
+        // UseNNUE was switched on after setPosition(), so there is nothing to update from
+        scratch.refresh[WHITE] = scratch.refresh[BLACK] = true;
+        return Nnue::evaluate(board, scratch);
+    }
+
+    Nnue::Accumulator& accumulator = accumulators.back();
+    int eval = Nnue::evaluate(board, accumulator);
+    if (debugChecks) {
+        Nnue::refresh(board, scratch, WHITE);
+        Nnue::refresh(board, scratch, BLACK);
+        if (std::memcmp(scratch.values, accumulator.values, sizeof(scratch.values)) != 0) {
+            std::cout << "info string NNUE accumulator out of sync at " << board.getFen() << std::endl;
+            assert(false);
+        }
+    }
+    return eval;
+}
+
+int Evaluation::taper(Score score, int phase) {
+    return (mgValue(score) * phase + egValue(score) * (totalPhase - phase)) / totalPhase;
+}
+
+int Evaluation::mopUpEval(const Board& board, int friendlyIndex, int opponentIndex, int friendlyMaterial, int opponentMaterial) {
     int mopUpScore = 0;
-    if (friendlyMaterial > opponentMaterial + pawnValue * 2 && endgameWeight > 0) {
+    if (friendlyMaterial > opponentMaterial + pawnValue * 2) {
         int friendlyKingSquare = board.kingSq(friendlyIndex).index();
         int opponentKingSquare = board.kingSq(opponentIndex).index();
-        mopUpScore += PrecomputedMoveData::centreManhattanDistance[opponentKingSquare] * 10;
-        mopUpScore += (14 - PrecomputedMoveData::numRookMovesToReachSquare(friendlyKingSquare, opponentKingSquare)) * 4;
-        
-        return (int)(mopUpScore * endgameWeight);
+        mopUpScore += PrecomputedMoveData::centreManhattanDistance[opponentKingSquare] * mopUpCentreWeight;
+        mopUpScore += (14 - PrecomputedMoveData::numRookMovesToReachSquare(friendlyKingSquare, opponentKingSquare)) * mopUpDistanceWeight;
+    }
+    return mopUpScore;
+}
+
+Score Evaluation::evaluatePieceActivity(const Board& board) {
+    NoTrace trace;
+    return evaluatePieceActivity(board, trace);
+}
+
+template <typename Trace>
+Score Evaluation::evaluatePieceActivity(const Board& board, Trace& trace) {
+    AttackMaps maps;
+    for (int color = 0; color < 2; color++) {
+        const Bitboard pawns = board.pieces(PieceType::PAWN, color);
+        maps.byPawns[color] = color == WHITE
+            ? attacks::pawnLeftAttacks<Color::WHITE>(pawns) | attacks::pawnRightAttacks<Color::WHITE>(pawns)
+            : attacks::pawnLeftAttacks<Color::BLACK>(pawns) | attacks::pawnRightAttacks<Color::BLACK>(pawns);
+
+        const Square king = board.kingSq(color);
+        maps.kingZone[color] = attacks::king(king) | Bitboard::fromSquare(king);
+        maps.all[color] = maps.byPawns[color] | attacks::king(king);
+    }
+
+    // Mobility completes the attack maps, so it has to run for both sides before king safety
+    Score mobility[2] = { evaluateMobility(board, WHITE, maps), evaluateMobility(board, BLACK, maps) };
+    Score kingSafety[2] = { evaluateKingSafety(WHITE, maps), evaluateKingSafety(BLACK, maps) };
+
+    if constexpr (Trace::enabled) {
+        for (int color = 0; color < 2; color++) {
+            trace.mobility[color] = mobility[color];
+            trace.kingSafety[color] = kingSafety[color];
+        }
     }
-    return 0;
+    return mobility[WHITE] - mobility[BLACK] + kingSafety[WHITE] - kingSafety[BLACK];
 }
 
-int Evaluation::countMaterial(int color) {
+template Score Evaluation::evaluatePieceActivity<NoTrace>(const Board& board, NoTrace& trace);
+template Score Evaluation::evaluatePieceActivity<EvalTrace>(const Board& board, EvalTrace& trace);
+
+Score Evaluation::evaluateMobility(const Board& board, int color, AttackMaps& maps) {
+    const int them = color ^ 1;
+    const Bitboard occupied = board.occ();
+    // Squares that are neither blocked by own pieces nor controlled by enemy pawns
+    const Bitboard area = ~board.us(color) & ~maps.byPawns[them];
+    Score score = 0;
+
+    auto visit = [&](PieceType type, auto attacksFrom) {
+        const int index = static_cast<int>(type.internal());
+        Bitboard pieces = board.pieces(type, color);
+        while (!pieces.empty()) {
+            const Bitboard attacked = attacksFrom(Square(pieces.pop()));
+            maps.all[color] |= attacked;
+            score += mobilityBonus[index] * ((attacked & area).count() - mobilityBaseline[index]);
+
+            const Bitboard zoneAttacks = attacked & maps.kingZone[them];
+            if (!zoneAttacks.empty()) {
+                maps.kingAttackers[color]++;
+                maps.kingAttackUnits[color] += kingAttackWeight[index] * zoneAttacks.count();
+            }
+        }
+    };
+    visit(PieceType::KNIGHT, [](Square square) { return attacks::knight(square); });
+    visit(PieceType::BISHOP, [&](Square square) { return Sliders::bishop(square, occupied); });
+    visit(PieceType::ROOK, [&](Square square) { return Sliders::rook(square, occupied); });
+    visit(PieceType::QUEEN, [&](Square square) { return Sliders::queen(square, occupied); });
+    return score;
+}
+
+Score Evaluation::evaluateKingSafety(int color, const AttackMaps& maps) {
+    const int them = color ^ 1;
+    // A lone attacker rarely amounts to a real threat
+    if (maps.kingAttackers[them] < 2) return 0;
+
+    // Zone squares the enemy hits that no own pawn covers
+    const Bitboard weak = maps.kingZone[color] & maps.all[them] & ~maps.byPawns[color];
+    const int danger = maps.kingAttackUnits[them] + 2 * weak.count();
+    return makeScore(-std::min(danger * danger / 8, maxKingDanger), 0);
+}
+
+int Evaluation::countMaterial(const Board& board, int color) {
     int material = 0;
     material += board.pieces(PieceType::PAWN, color).count() * pawnValue;
     material += board.pieces(PieceType::KNIGHT, color).count() * knightValue;
@@ -58,27 +367,52 @@ int Evaluation::countMaterial(int color) {
     return material;
 }
 
-int Evaluation::evaluatePieceSquareTables(int color, float endgamePhaseWeight) {
-    int value = 0;
+int Evaluation::countPhase(const Board& board) {
+    int phase = 0;
+    phase += board.pieces(PieceType::KNIGHT).count() * knightPhase;
+    phase += board.pieces(PieceType::BISHOP).count() * bishopPhase;
+    phase += board.pieces(PieceType::ROOK).count() * rookPhase;
+    phase += board.pieces(PieceType::QUEEN).count() * queenPhase;
+    return phase;
+}
+
+Score Evaluation::evaluatePieceSquareTables(const Board& board, int color) {
+    Score value = 0;
     bool isWhite = color == WHITE;
-    value += evaluatePieceSquareTable(PieceSquareTable::pawns, board.pieces(PieceType::PAWN, color), isWhite);
-    value += evaluatePieceSquareTable(PieceSquareTable::knights, board.pieces(PieceType::KNIGHT, color), isWhite);
-    value += evaluatePieceSquareTable(PieceSquareTable::bishops, board.pieces(PieceType::BISHOP, color), isWhite);
-    value += evaluatePieceSquareTable(PieceSquareTable::rooks, board.pieces(PieceType::ROOK, color), isWhite);
-    value += evaluatePieceSquareTable(PieceSquareTable::queens, board.pieces(PieceType::QUEEN, color), isWhite);
-    int kingEarlyPhase = PieceSquareTable::read(PieceSquareTable::kingMiddle, board.kingSq(color).index(), isWhite);
-    value += (int)(kingEarlyPhase * (1 - endgamePhaseWeight));
+    value += evaluatePieceSquareTable(PieceType::PAWN, board.pieces(PieceType::PAWN, color), isWhite);
+    value += evaluatePieceSquareTable(PieceType::KNIGHT, board.pieces(PieceType::KNIGHT, color), isWhite);
+    value += evaluatePieceSquareTable(PieceType::BISHOP, board.pieces(PieceType::BISHOP, color), isWhite);
+    value += evaluatePieceSquareTable(PieceType::ROOK, board.pieces(PieceType::ROOK, color), isWhite);
+    value += evaluatePieceSquareTable(PieceType::QUEEN, board.pieces(PieceType::QUEEN, color), isWhite);
+    value += evaluatePieceSquareTable(PieceType::KING, board.pieces(PieceType::KING, color), isWhite);
     return value;
 }
 
-int Evaluation::evaluatePieceSquareTable(const int* table, Bitboard pieces, bool isWhite) {
-    int value = 0;
-    std::vector<int> indices;
-    while (!pieces.empty()) {
-        indices.push_back(pieces.pop());
+int Evaluation::pieceValue(PieceType type) {
+    switch (type.internal()) {
+        case PieceType::PAWN: return pawnValue;
+        case PieceType::KNIGHT: return knightValue;
+        case PieceType::BISHOP: return bishopValue;
+        case PieceType::ROOK: return rookValue;
+        case PieceType::QUEEN: return queenValue;
+        default: return 0;
+    }
+}
+
+int Evaluation::piecePhase(PieceType type) {
+    switch (type.internal()) {
+        case PieceType::KNIGHT: return knightPhase;
+        case PieceType::BISHOP: return bishopPhase;
+        case PieceType::ROOK: return rookPhase;
+        case PieceType::QUEEN: return queenPhase;
+        default: return 0;
     }
-    for (int i = 0; i < indices.size(); i++) {
-        value += PieceSquareTable::read(table, indices[i], isWhite);
+}
+
+Score Evaluation::evaluatePieceSquareTable(PieceType type, Bitboard pieces, bool isWhite) {
+    Score value = 0;
+    while (!pieces.empty()) {
+        value += pieceSquareScore(type, pieces.pop(), isWhite);
     }
     return value;
 }
@@ -1,74 +1,361 @@
 #ifndef EVALUATION_HPP
 #define EVALUATION_HPP
 
+#include <array>
+#include <string>
+#include <vector>
 #include "chess.hpp"
+#include "nnue.hpp"
+#include "pawns.hpp"
+#include "tables.hpp"
 
 namespace chess {
 
+// Middlegame and endgame values packed into one integer so both phases accumulate
+// with a single add: the endgame half lives in the upper 16 bits
+using Score = int32_t;
+
+constexpr Score makeScore(int mg, int eg) {
+    return static_cast<Score>(static_cast<uint32_t>(eg) << 16) + mg;
+}
+
+constexpr int mgValue(Score score) {
+    return static_cast<int16_t>(static_cast<uint16_t>(static_cast<uint32_t>(score)));
+}
+
+constexpr int egValue(Score score) {
+    return static_cast<int16_t>(static_cast<uint16_t>(static_cast<uint32_t>(score + 0x8000) >> 16));
+}
+
+// Trace policies for computeEvaluation(). The search instantiates it with NoTrace, where every
+// `if constexpr (Trace::enabled)` block compiles away; EvalTrace records the breakdown.
+struct NoTrace {
+    static constexpr bool enabled = false;
+};
+
+struct EvalTrace {
+    static constexpr bool enabled = true;
+    int phase = 0;                 // Middlegame weight out of totalPhase, the rest is the endgame weight
+    int material[2] = {0, 0};
+    Score pieceSquares[2][6] = {}; // Placement only, indexed by piece type
+    int mopUp[2] = {0, 0};         // Applied to the endgame half only
+    Score mobility[2] = {0, 0};
+    Score kingSafety[2] = {0, 0};
+    int pawnStructure = 0;         // Net of both sides, from white's perspective
+    int total = 0;                 // From the perspective of the side to move
+};
+
 class Evaluation {
 public:
-    static int const pawnValue = 100;
-    static int const knightValue = 300;
-    static int const bishopValue = 320;
-    static int const rookValue = 500;
-    static int const queenValue = 900;
-    
-    float endgameMaterial = rookValue * 2 + bishopValue + knightValue;
+    static int const pawnValue = PieceSquareTable::pawnValue;
+    static int const knightValue = PieceSquareTable::knightValue;
+    static int const bishopValue = PieceSquareTable::bishopValue;
+    static int const rookValue = PieceSquareTable::rookValue;
+    static int const queenValue = PieceSquareTable::queenValue;
+
+
+    // Game phase runs from totalPhase with all pieces on the board down to 0 in a pawn endgame
+    static int const knightPhase = 1;
+    static int const bishopPhase = 1;
+    static int const rookPhase = 2;
+    static int const queenPhase = 4;
+    static int const totalPhase = 4 * knightPhase + 4 * bishopPhase + 4 * rookPhase + 2 * queenPhase;
     int maxDepth = 4;
-    int WHITE = 0;
-    int BLACK = 1;
-    
-    Board board;
+    static int const WHITE = 0;
+    static int const BLACK = 1;
+
+    // Material plus piece-square value per [color][piece type][square], built at compile time
+    // from the tables in tables.hpp and pre-flipped so white reads them from its own side
+    static constexpr std::array<std::array<std::array<Score, 64>, 6>, 2> pieceSquareScores = []() constexpr {
+        std::array<std::array<std::array<Score, 64>, 6>, 2> scores{};
+        const int values[6] = { pawnValue, knightValue, bishopValue, rookValue, queenValue, 0 };
+        const int* middlegame[6] = { PieceSquareTable::pawns, PieceSquareTable::knights, PieceSquareTable::bishops,
+                                     PieceSquareTable::rooks, PieceSquareTable::queens, PieceSquareTable::kingMiddle };
+        const int* endgame[6] = { PieceSquareTable::pawns, PieceSquareTable::knights, PieceSquareTable::bishops,
+                                  PieceSquareTable::rooks, PieceSquareTable::queens, PieceSquareTable::kingEnd };
+        for (int color = 0; color < 2; color++) {
+            for (int piece = 0; piece < 6; piece++) {
+                for (int square = 0; square < 64; square++) {
+                    // Tables are laid out with rank 8 first, which is black's view of the board
+                    int index = color == WHITE ? square ^ 56 : square;
+                    scores[color][piece][square] = makeScore(values[piece] + middlegame[piece][index],
+                                                             values[piece] + endgame[piece][index]);
+                }
+            }
+        }
+        return scores;
+    }();
+
+    // Mop-up rewards driving the losing king to the edge and walking our own king towards it
+    static int const mopUpCentreWeight = PieceSquareTable::mopUpCentreWeight;
+    static int const mopUpDistanceWeight = PieceSquareTable::mopUpDistanceWeight;
+
+    // Mobility per attacked square outside the baseline count, indexed by piece type
+    static constexpr Score mobilityBonus[6] = {
+        0, makeScore(4, 4), makeScore(5, 5), makeScore(2, 4), makeScore(1, 2), 0
+    };
+    static constexpr int mobilityBaseline[6] = { 0, 4, 6, 7, 13, 0 };
+
+    // Weight of each attacked king-zone square, indexed by the attacking piece type
+    static constexpr int kingAttackWeight[6] = { 0, 2, 2, 3, 5, 0 };
+    static constexpr int maxKingDanger = 500;
+
+    // Attack maps built once per evaluation and shared by the mobility and king safety terms
+    struct AttackMaps {
+        Bitboard byPawns[2];
+        Bitboard all[2];                 // Squares attacked by any piece of the side, king included
+        Bitboard kingZone[2];            // King square and its neighbours
+        int kingAttackers[2] = {0, 0};   // Pieces of the side attacking the enemy king zone
+        int kingAttackUnits[2] = {0, 0}; // Weighted attacks of the side on the enemy king zone
+    };
+
+    // Per-thread cache of pawn structure terms
+    PawnHashTable pawnTable;
+
+    // Per-thread direct-mapped cache of full evaluations keyed by Board::hash()
+    struct CacheEntry {
+        uint64_t key;
+        int score; // From the perspective of the side to move, which the key includes
+    };
+    static constexpr size_t evalCacheSize = 1 << 16;
+    std::vector<CacheEntry> evalCache;
+    bool useEvalCache = true;
+    uint64_t evalCacheProbes = 0;
+    uint64_t evalCacheHits = 0;
+
+    // Incrementally maintained per-ply state, see makeMove()
+    struct State {
+        uint64_t pawnKey;
+        int material[2];
+        int phase;
+        Score pieceSquares[2]; // Material and placement, see pieceSquareScores
+
+        bool operator==(const State& other) const;
+    };
+    std::vector<State> states;
+
+    // Cross-checks the incremental state against a full recompute on every evaluation (UCI "debug on")
+    static inline bool debugChecks = false;
+
+    // Evaluate with the network instead of the handcrafted terms (UCI UseNNUE), honoured once
+    // a network is loaded. Accumulators are only kept for positions set up while it is on.
+    static inline bool useNnue = false;
+    static bool nnueActive() { return useNnue && Nnue::loaded(); }
+
+    // Lazy evaluation returns the incremental terms alone when they fall this far outside the
+    // window, since mobility, king safety and pawn structure rarely move the score further
+    static inline int lazyMargin = 250;
+    uint64_t lazyProbes = 0;
+    uint64_t lazyExits = 0;
+
+    // Incrementally updated NNUE accumulators, one per ply like states; empty when not using NNUE
+    std::vector<Nnue::Accumulator> accumulators;
+
+    Evaluation();
+
+    /**
+     * Resets the incremental state to a new root position
+     * @param board The root position of the search
+     */
+    void setPosition(const Board& board);
+
+    /**
+     * Updates the incremental state for a move, call before making it on the board
+     * @param board Board before the move
+     * @param move Move about to be made
+     */
+    void makeMove(const Board& board, Move move);
+
+    /**
+     * Reverts the incremental state of the last makeMove()
+     */
+    void unmakeMove();
+
+    /**
+     * Builds the incremental state for a board from scratch
+     * @param board The board to summarise
+     * @return State matching what makeMove() would have produced
+     */
+    State computeState(const Board& board);
+
+    /**
+     * Evaluates the current position on the board, without copying it or allocating
+     * @param board The chess board to evaluate
+     * @return Integer score from the perspective of the side to move
+     */
+    int evaluate(const Board& board);
+
+    /**
+     * Evaluates the position, stopping after the cheap incremental terms when they already
+     * fall more than lazyMargin outside the window
+     * @param board The chess board to evaluate
+     * @param alpha Lower bound of the search window, from the side to move's perspective
+     * @param beta Upper bound of the search window
+     * @return Integer score from the perspective of the side to move, only approximate
+     *         when outside the window
+     */
+    int evaluate(const Board& board, int alpha, int beta);
+
+    /**
+     * Evaluates the position without consulting the evaluation cache
+     * @param board The chess board to evaluate
+     * @return Integer score from the perspective of the side to move
+     */
+    int computeEvaluation(const Board& board);
+
+    /**
+     * Evaluates the position without consulting the evaluation cache, recording each term
+     * @param board The chess board to evaluate
+     * @param trace NoTrace, or EvalTrace to fill in the breakdown
+     * @return Integer score from the perspective of the side to move
+     */
+    template <typename Trace>
+    int computeEvaluation(const Board& board, Trace& trace);
+
+    /**
+     * Adds the terms that are not kept incrementally to an incremental score already computed,
+     * so the lazy evaluation does not repeat that work when its margin does not cut
+     * @param board The chess board to evaluate
+     * @param state Incremental state of the board
+     * @param incremental evaluateIncremental() of the board and state
+     * @param trace NoTrace, or EvalTrace to fill in the breakdown
+     * @return Integer score from the perspective of the side to move
+     */
+    template <typename Trace>
+    int computeEvaluation(const Board& board, const State& state, Score incremental, Trace& trace);
+
+    /**
+     * Explains the handcrafted evaluation of a position term by term
+     * @param board The chess board to evaluate
+     * @return JSON object with the per-side breakdown, see EvalTrace
+     */
+    std::string trace(const Board& board);
+
+    /**
+     * Evaluates material, piece-square tables and mop-up, which come from the incremental state
+     * @param board The chess board to evaluate
+     * @param state Incremental state of the board
+     * @return Packed score from white's perspective, before tapering
+     */
+    static Score evaluateIncremental(const Board& board, const State& state);
+
+    /**
+     * Incremental state of the current ply, or a fresh one when setPosition() was not called
+     * @param board The chess board being evaluated
+     * @return State of the board, cross-checked against a recompute with debugChecks
+     */
+    State currentState(const Board& board);
 
     /**
-     * Evaluates the current position on the board
+     * Evaluates the position with the loaded network, using the accumulator of the current ply
      * @param board The chess board to evaluate
      * @return Integer score from the perspective of the side to move
      */
-    int evaluate(Board board);
+    int evaluateNnue(const Board& board);
 
     /**
-     * Calculates the weight of the endgame phase based on material
-     * @param materialCountWithoutPawns Total material value excluding pawns
-     * @return Float between 0 and 1 representing endgame phase
+     * Blends a packed score by game phase
+     * @param score Packed middlegame/endgame score
+     * @param phase Game phase between 0 (endgame) and totalPhase (opening)
+     * @return Integer score interpolated between the two halves
      */
-    float endgamePhaseWeight(int materialCountWithoutPawns);
+    static int taper(Score score, int phase);
 
     /**
      * Evaluates king safety and piece coordination in endgame positions
+     * @param board The board being evaluated
      * @param friendlyIndex Index of friendly color
      * @param opponentIndex Index of opponent color
      * @param friendlyMaterial Total material value of friendly pieces
      * @param opponentMaterial Total material value of opponent pieces
-     * @param endgameWeight Current weight of endgame phase
-     * @return Integer score for mop-up evaluation
+     * @return Integer score for mop-up evaluation, applied to the endgame half only
      */
-    int mopUpEval(int friendlyIndex, int opponentIndex, int friendlyMaterial, 
-                  int opponentMaterial, float endgameWeight);
+    static int mopUpEval(const Board& board, int friendlyIndex, int opponentIndex, int friendlyMaterial, int opponentMaterial);
+
+    /**
+     * Evaluates mobility and king safety from attack maps built for this board
+     * @param board The board being evaluated
+     * @return Packed score from white's perspective
+     */
+    static Score evaluatePieceActivity(const Board& board);
+
+    template <typename Trace>
+    static Score evaluatePieceActivity(const Board& board, Trace& trace);
+
+    /**
+     * Scores the mobility of one side's knights, bishops, rooks and queens, adding their
+     * attacks to the side's attack map and king-zone attack counters on the way
+     * @param board The board being evaluated
+     * @param color Color to evaluate
+     * @param maps Attack maps with pawn and king attacks already filled in
+     * @return Packed mobility score for the side
+     */
+    static Score evaluateMobility(const Board& board, int color, AttackMaps& maps);
+
+    /**
+     * Scores the danger to one side's king from the enemy attacks on its zone
+     * @param color Color whose king is evaluated
+     * @param maps Attack maps completed for both sides by evaluateMobility()
+     * @return Packed score for the side, zero or negative
+     */
+    static Score evaluateKingSafety(int color, const AttackMaps& maps);
 
     /**
      * Counts total material value for given color
+     * @param board The board being evaluated
      * @param color Color to evaluate (WHITE or BLACK)
      * @return Total material value
      */
-    int countMaterial(int color);
+    static int countMaterial(const Board& board, int color);
 
     /**
-     * Evaluates piece placement using piece-square tables
+     * Sums the game phase contribution of the pieces on the board
+     * @param board The board being evaluated
+     * @return Game phase, uncapped
+     */
+    static int countPhase(const Board& board);
+
+    /**
+     * Evaluates material and piece placement using piece-square tables
+     * @param board The board being evaluated
      * @param color Color to evaluate
-     * @param endgamePhaseWeight Current weight of endgame phase
-     * @return Integer score for piece placement
+     * @return Packed score for material and piece placement
+     */
+    static Score evaluatePieceSquareTables(const Board& board, int color);
+
+    /**
+     * Material value of a piece type
+     * @param type Piece type, the king counts as zero
+     * @return Value in centipawns
+     */
+    static int pieceValue(PieceType type);
+
+    /**
+     * Game phase contribution of a piece type
+     * @param type Piece type, pawns and the king count as zero
+     * @return Phase weight
+     */
+    static int piecePhase(PieceType type);
+
+    /**
+     * Material and piece-square table value of a single piece
+     * @param type Piece type
+     * @param square Square the piece stands on
+     * @param isWhite Whether the piece is white
+     * @return Packed score for the piece on its square
      */
-    int evaluatePieceSquareTables(int color, float endgamePhaseWeight);
+    static Score pieceSquareScore(PieceType type, int square, bool isWhite) {
+        return pieceSquareScores[isWhite ? WHITE : BLACK][static_cast<int>(type.internal())][square];
+    }
 
     /**
-     * Evaluates specific piece type placement using piece-square table
-     * @param table Piece-square table to use
+     * Evaluates material and placement of one piece type using the merged tables
+     * @param type Piece type to look up
      * @param pieces Bitboard of pieces to evaluate
      * @param isWhite Whether evaluating for white pieces
-     * @return Integer score for piece placement
+     * @return Packed score for material and piece placement
      */
-    int evaluatePieceSquareTable(const int* table, Bitboard pieces, bool isWhite);
+    static Score evaluatePieceSquareTable(PieceType type, Bitboard pieces, bool isWhite);
 };
 
 } // namespace chess
@@ -3,11 +3,16 @@
 #include <thread>
 #include <vector>
 #include <atomic>
+#include <algorithm>
 #include <unistd.h>
 #include "engine.hpp"
+#include "bench.hpp"
+#include "evaluation.hpp"
+#include "nnue.hpp"
 
 std::atomic<bool> stop_search(false);
 int num_threads = 1;
+int hash_size = 64;
 bool ponder = false;
 bool limitStrength = false;
 int elo = 2500;
@@ -16,7 +21,7 @@ bool showWDL = false;
 void uci_loop() {
     std::string command;
     Board board;
-    Engine engine(4, board);
+    Engine engine(4, board, hash_size);
     
     std::cout << "id name WardenBot" << std::endl;
     std::cout << "id author Edward Baker" << std::endl;
@@ -28,6 +33,9 @@ void uci_loop() {
     std::cout << "option name UCI_Elo type spin default 2500 min 1350 max 2850" << std::endl;
     std::cout << "option name UCI_ShowWDL type check default false" << std::endl;
     std::cout << "option name SyzygyPath type string default " << std::endl;
+    std::cout << "option name EvalFile type string default " << std::endl;
+    std::cout << "option name UseNNUE type check default false" << std::endl;
+    std::cout << "option name LazyEvalMargin type spin default 250 min 0 max 2000" << std::endl;
     std::cout << "uciok" << std::endl;
     
     while (std::getline(std::cin, command)) {
@@ -47,8 +55,16 @@ void uci_loop() {
             std::cout << "option name UCI_Elo type spin default 2500 min 1350 max 2850" << std::endl;
             std::cout << "option name UCI_ShowWDL type check default false" << std::endl;
             std::cout << "option name SyzygyPath type string default " << std::endl;
+            std::cout << "option name EvalFile type string default " << std::endl;
+            std::cout << "option name UseNNUE type check default false" << std::endl;
+            std::cout << "option name LazyEvalMargin type spin default 250 min 0 max 2000" << std::endl;
             std::cout << "uciok" << std::endl;
         } 
+        else if (token == "debug") {
+            std::string mode;
+            iss >> mode;
+            Evaluation::debugChecks = (mode == "on");
+        }
         else if (token == "isready") {
             std::cout << "readyok" << std::endl;
         } 
@@ -78,11 +94,19 @@ void uci_loop() {
                 // Handle different options
                 if (optionName == "Threads") {
                     try {
-                        num_threads = std::stoi(optionValue);
-                        // You would update your engine's thread count here
+                        num_threads = std::clamp(std::stoi(optionValue), 1, 16);
                     } catch (...) {
                         num_threads = 1;
                     }
+                    engine.setThreads(num_threads);
+                }
+                else if (optionName == "Hash") {
+                    try {
+                        hash_size = std::clamp(std::stoi(optionValue), 1, static_cast<int>(TranspositionTable::maxSizeMb));
+                    } catch (...) {
+                        hash_size = 64;
+                    }
+                    engine.setHashSize(hash_size);
                 }
                 else if (optionName == "Ponder") {
                     ponder = (optionValue == "true");
@@ -102,11 +126,33 @@ void uci_loop() {
                 else if (optionName == "UCI_ShowWDL") {
                     showWDL = (optionValue == "true");
                 }
+                else if (optionName == "EvalFile") {
+                    if (Nnue::load(optionValue)) {
+                        std::cout << "info string loaded network " << optionValue
+                                  << " kernel " << Nnue::kernel() << std::endl;
+                    } else {
+                        std::cout << "info string failed to load network " << optionValue << std::endl;
+                    }
+                }
+                else if (optionName == "LazyEvalMargin") {
+                    try {
+                        Evaluation::lazyMargin = std::clamp(std::stoi(optionValue), 0, 2000);
+                    } catch (...) {
+                        Evaluation::lazyMargin = 250;
+                    }
+                }
+                else if (optionName == "UseNNUE") {
+                    Evaluation::useNnue = (optionValue == "true");
+                    if (Evaluation::useNnue && !Nnue::loaded()) {
+                        std::cout << "info string no network loaded, set EvalFile first" << std::endl;
+                    }
+                }
             }
         } 
         else if (token == "ucinewgame") {
             board = Board();
-            Engine engine(4, board); 
+            engine.newGame();
+            engine.setPosition(board);
         } 
         else if (token == "position") {
             std::string pos_type;
@@ -179,20 +225,62 @@ void uci_loop() {
         else if (token == "go") {
             stop_search = false;
             
-            // Launch search in a separate thread
-            std::thread search_thread([&]() {
-                Move bestMove = engine.getMove(board);
-                if (!stop_search) {
-                    std::cout << "bestmove " << uci::moveToUci(bestMove) << std::endl;
-                }
+            // The search runs on the engine's thread and reports bestmove however it ends
+            engine.go(board, [](Move bestMove) {
+                // UCI's null move, for a root that is already mate or stalemate
+                std::cout << "bestmove " << (bestMove == Move::NO_MOVE ? "0000" : uci::moveToUci(bestMove)) << std::endl;
             });
-            search_thread.detach(); 
         } 
         else if (token == "stop") {
             stop_search = true;
-            Move bestMove = engine.getMove(board);
-            std::cout << "bestmove " << uci::moveToUci(bestMove) << std::endl;
+            engine.stop();
         } 
+        else if (token == "savehash" || token == "loadhash") {
+            std::string path;
+            std::getline(iss, path);
+            if (!path.empty() && path[0] == ' ') {
+                path = path.substr(1);
+            }
+
+            // A loadhash during go ends that search first, with its bestmove, because the
+            // search threads probe the table that is being replaced
+            if (token == "savehash") {
+                bool saved = engine.saveHash(path);
+                std::cout << "info string " << (saved ? "saved hash to " : "failed to save hash to ") << path << std::endl;
+            } else if (engine.loadHash(path)) {
+                hash_size = static_cast<int>(engine.hashSizeMb());
+                std::cout << "info string loaded hash from " << path << " size " << hash_size << " MB" << std::endl;
+            } else {
+                std::cout << "info string rejected hash file " << path << std::endl;
+            }
+        }
+        else if (token == "hashstats") {
+            const TranspositionTable& table = engine.transposition();
+            TranspositionTable::Stats stats = table.stats();
+            auto percent = [](uint64_t part, uint64_t whole) {
+                return whole ? 100.0 * part / whole : 0.0;
+            };
+            std::cout << "info string hash " << table.sizeMb() << " MB hashfull " << table.hashfull() << std::endl;
+            std::cout << "info string probes " << stats.probes
+                      << " hits " << stats.hits << " (" << percent(stats.hits, stats.probes) << "%)"
+                      << " cutoffs " << stats.cutoffs << " (" << percent(stats.cutoffs, stats.probes) << "%)" << std::endl;
+            std::cout << "info string stores " << stats.stores
+                      << " overwrites " << stats.overwrites << " (" << percent(stats.overwrites, stats.stores) << "%)"
+                      << " collisions " << stats.collisions << std::endl;
+        }
+        else if (token == "eval") {
+            Evaluation evaluation;
+            evaluation.setPosition(board);
+            std::cout << evaluation.trace(board) << std::endl;
+        }
+        else if (token == "bench") {
+            // bench [section] [depth]
+            std::string section;
+            int depth = 5;
+            iss >> section >> depth;
+            if (section == "all") section.clear();
+            Benchmark::run(section, depth, hash_size, num_threads);
+        }
         else if (token == "quit") {
             break;
         }
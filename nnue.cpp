@@ -0,0 +1,368 @@
+#include "nnue.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define NNUE_X86
+#include <immintrin.h>
+#endif
+
+namespace chess {
+
+namespace {
+
+// File layout: a 64-byte header, then int16 feature weights [inputs][hidden], int16 feature
+// biases [hidden], int8 output weights [2][hidden] (side to move first) and an int32 output
+// bias, all little-endian. Keeping the header a cache line long leaves the weights aligned.
+constexpr char fileMagic[8] = {'W', 'B', 'N', 'N', 'U', 'E', 0, 0};
+constexpr uint32_t fileVersion = 1;
+constexpr size_t headerBytes = 64;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t inputs;
+    uint32_t hidden;
+};
+
+constexpr size_t featureWeightBytes = sizeof(int16_t) * Nnue::inputs * Nnue::hidden;
+constexpr size_t featureBiasBytes = sizeof(int16_t) * Nnue::hidden;
+constexpr size_t outputWeightBytes = sizeof(int8_t) * 2 * Nnue::hidden;
+constexpr size_t fileBytes = headerBytes + featureWeightBytes + featureBiasBytes + outputWeightBytes + sizeof(int32_t);
+
+struct Network {
+    const int16_t* featureWeights = nullptr;
+    const int16_t* featureBiases = nullptr;
+    const int8_t* outputWeights = nullptr;
+    int32_t outputBias = 0;
+};
+
+// Shared by all search threads and only replaced from the UCI thread between searches
+Network network;
+std::string networkName;
+void* mapping = nullptr;
+size_t mappingBytes = 0;
+std::vector<char> storage; // Backing store when the network is not memory-mapped
+
+void release() {
+#if defined(__linux__) || defined(__APPLE__)
+    if (mapping) munmap(mapping, mappingBytes);
+#endif
+    mapping = nullptr;
+    mappingBytes = 0;
+    std::vector<char>().swap(storage);
+    network = Network();
+    networkName.clear();
+}
+
+void install(const char* data) {
+    network.featureWeights = reinterpret_cast<const int16_t*>(data + headerBytes);
+    network.featureBiases = reinterpret_cast<const int16_t*>(data + headerBytes + featureWeightBytes);
+    network.outputWeights = reinterpret_cast<const int8_t*>(data + headerBytes + featureWeightBytes + featureBiasBytes);
+    std::memcpy(&network.outputBias, data + fileBytes - sizeof(int32_t), sizeof(int32_t));
+}
+
+const int16_t* featureColumn(int index) {
+    return network.featureWeights + static_cast<size_t>(index) * Nnue::hidden;
+}
+
+// Copies parent into child while adding and subtracting feature columns
+using UpdateKernel = void (*)(const int16_t* parent, int16_t* child, const int16_t* const* added, int addedCount,
+                              const int16_t* const* removed, int removedCount);
+// Clipped ReLU of both accumulator halves dotted with the output weights
+using OutputKernel = int32_t (*)(const int16_t* us, const int16_t* them, const int8_t* weights);
+
+void updateScalar(const int16_t* parent, int16_t* child, const int16_t* const* added, int addedCount,
+                  const int16_t* const* removed, int removedCount) {
+    // Column at a time so the compiler can vectorise each pass on targets without a kernel above
+    std::memcpy(child, parent, sizeof(int16_t) * Nnue::hidden);
+    for (int k = 0; k < addedCount; k++) {
+        for (int i = 0; i < Nnue::hidden; i++) child[i] += added[k][i];
+    }
+    for (int k = 0; k < removedCount; k++) {
+        for (int i = 0; i < Nnue::hidden; i++) child[i] -= removed[k][i];
+    }
+}
+
+int32_t outputScalar(const int16_t* us, const int16_t* them, const int8_t* weights) {
+    int32_t sum = 0;
+    for (int i = 0; i < Nnue::hidden; i++) {
+        sum += std::min(std::max<int>(us[i], 0), Nnue::activationMax) * weights[i];
+        sum += std::min(std::max<int>(them[i], 0), Nnue::activationMax) * weights[Nnue::hidden + i];
+    }
+    return sum;
+}
+
+#if defined(NNUE_X86)
+
+__attribute__((target("sse4.1")))
+void updateSse41(const int16_t* parent, int16_t* child, const int16_t* const* added, int addedCount,
+                 const int16_t* const* removed, int removedCount) {
+    for (int i = 0; i < Nnue::hidden; i += 8) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(parent + i));
+        for (int k = 0; k < addedCount; k++) {
+            value = _mm_add_epi16(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(added[k] + i)));
+        }
+        for (int k = 0; k < removedCount; k++) {
+            value = _mm_sub_epi16(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(removed[k] + i)));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(child + i), value);
+    }
+}
+
+__attribute__((target("sse4.1")))
+int32_t outputSse41(const int16_t* us, const int16_t* them, const int8_t* weights) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi16(Nnue::activationMax);
+    const int16_t* halves[2] = {us, them};
+    __m128i sum = zero;
+    for (int half = 0; half < 2; half++) {
+        for (int i = 0; i < Nnue::hidden; i += 8) {
+            __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(halves[half] + i));
+            input = _mm_min_epi16(_mm_max_epi16(input, zero), max);
+            __m128i weight = _mm_cvtepi8_epi16(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(weights + half * Nnue::hidden + i)));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(input, weight));
+        }
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+__attribute__((target("avx2")))
+void updateAvx2(const int16_t* parent, int16_t* child, const int16_t* const* added, int addedCount,
+                const int16_t* const* removed, int removedCount) {
+    for (int i = 0; i < Nnue::hidden; i += 16) {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(parent + i));
+        for (int k = 0; k < addedCount; k++) {
+            value = _mm256_add_epi16(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(added[k] + i)));
+        }
+        for (int k = 0; k < removedCount; k++) {
+            value = _mm256_sub_epi16(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(removed[k] + i)));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(child + i), value);
+    }
+}
+
+__attribute__((target("avx2")))
+int32_t outputAvx2(const int16_t* us, const int16_t* them, const int8_t* weights) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi16(Nnue::activationMax);
+    const int16_t* halves[2] = {us, them};
+    __m256i sum = zero;
+    for (int half = 0; half < 2; half++) {
+        for (int i = 0; i < Nnue::hidden; i += 16) {
+            __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(halves[half] + i));
+            input = _mm256_min_epi16(_mm256_max_epi16(input, zero), max);
+            __m256i weight = _mm256_cvtepi8_epi16(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + half * Nnue::hidden + i)));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(input, weight));
+        }
+    }
+    __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0x4E));
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0xB1));
+    return _mm_cvtsi128_si32(total);
+}
+
+#endif
+
+struct Kernels {
+    UpdateKernel update;
+    OutputKernel output;
+    const char* name;
+};
+
+// Kernels this CPU can run, fastest first
+std::vector<Kernels> supportedKernels() {
+    std::vector<Kernels> supported;
+#if defined(NNUE_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) supported.push_back({updateAvx2, outputAvx2, "avx2"});
+    if (__builtin_cpu_supports("sse4.1")) supported.push_back({updateSse41, outputSse41, "sse4.1"});
+#endif
+    supported.push_back({updateScalar, outputScalar, "scalar"});
+    return supported;
+}
+
+Kernels kernels = supportedKernels().front();
+
+} // namespace
+
+bool Nnue::load(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    FileHeader header{};
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1
+           && std::memcmp(header.magic, fileMagic, sizeof(header.magic)) == 0
+           && header.version == fileVersion
+           && header.inputs == inputs
+           && header.hidden == hidden
+           && std::fseek(file, 0, SEEK_END) == 0
+           && static_cast<size_t>(std::ftell(file)) == fileBytes;
+    if (!ok) {
+        std::fclose(file);
+        return false;
+    }
+
+#if defined(__linux__) || defined(__APPLE__)
+    // Read-only private mapping: weights page in on first use and are shared with the page cache
+    void* memory = mmap(nullptr, fileBytes, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    std::fclose(file);
+    if (memory == MAP_FAILED) return false;
+
+    release();
+    mapping = memory;
+    mappingBytes = fileBytes;
+    install(static_cast<const char*>(memory));
+#else
+    std::vector<char> data(fileBytes);
+    ok = std::fseek(file, 0, SEEK_SET) == 0 && std::fread(data.data(), 1, fileBytes, file) == fileBytes;
+    std::fclose(file);
+    if (!ok) return false;
+
+    release();
+    storage.swap(data);
+    install(storage.data());
+#endif
+
+    networkName = path;
+    return true;
+}
+
+void Nnue::loadRandom(uint64_t seed) {
+    release();
+    storage.assign(fileBytes, 0);
+    std::mt19937_64 rng(seed);
+
+    // Small feature weights keep a full board of accumulated columns well inside int16
+    int16_t* weights = reinterpret_cast<int16_t*>(storage.data() + headerBytes);
+    for (size_t i = 0; i < static_cast<size_t>(inputs) * hidden + hidden; i++) {
+        weights[i] = static_cast<int16_t>(static_cast<int>(rng() % 33) - 16);
+    }
+    int8_t* output = reinterpret_cast<int8_t*>(storage.data() + headerBytes + featureWeightBytes + featureBiasBytes);
+    for (int i = 0; i < 2 * hidden; i++) {
+        output[i] = static_cast<int8_t>(static_cast<int>(rng() % 129) - 64);
+    }
+
+    install(storage.data());
+    networkName = "<random>";
+}
+
+void Nnue::unload() {
+    release();
+}
+
+bool Nnue::loaded() {
+    return network.featureWeights != nullptr;
+}
+
+const std::string& Nnue::fileName() {
+    return networkName;
+}
+
+const char* Nnue::kernel() {
+    return kernels.name;
+}
+
+std::vector<std::string> Nnue::kernelNames() {
+    std::vector<std::string> names;
+    for (const Kernels& supported : supportedKernels()) names.push_back(supported.name);
+    return names;
+}
+
+bool Nnue::useKernel(const std::string& name) {
+    for (const Kernels& supported : supportedKernels()) {
+        if (name == supported.name) {
+            kernels = supported;
+            return true;
+        }
+    }
+    return false;
+}
+
+int Nnue::featureIndex(int perspective, int kingSquare, Piece piece, int square) {
+    // Black sees the board from its own side, so both perspectives share one set of weights
+    const int flip = perspective == 0 ? 0 : 56;
+    const int type = static_cast<int>(piece.type().internal());
+    const int relative = static_cast<int>(piece.color().internal()) == perspective ? 0 : 1;
+    return ((kingSquare ^ flip) * pieceFeatures + type * 2 + relative) * 64 + (square ^ flip);
+}
+
+void Nnue::refresh(const Board& board, Accumulator& accumulator, int perspective) {
+    const int kingSquare = board.kingSq(perspective).index();
+    const int16_t* added[32];
+    int addedCount = 0;
+
+    Bitboard pieces = board.occ() & ~board.pieces(PieceType::KING);
+    while (!pieces.empty()) {
+        const int square = pieces.pop();
+        added[addedCount++] = featureColumn(featureIndex(perspective, kingSquare, board.at(Square(square)), square));
+    }
+
+    kernels.update(network.featureBiases, accumulator.values[perspective], added, addedCount, nullptr, 0);
+    accumulator.refresh[perspective] = false;
+}
+
+void Nnue::update(const Board& board, Move move, Accumulator& parent, Accumulator& child) {
+    const int us = board.sideToMove();
+    const int from = move.from().index();
+    const int to = move.to().index();
+    const Piece moved = board.at(move.from());
+
+    for (int perspective = 0; perspective < 2; perspective++) {
+        // A king move changes every feature of its own side, so that side is rebuilt on use instead
+        child.refresh[perspective] = perspective == us && moved == PieceType::KING;
+        if (child.refresh[perspective]) continue;
+        if (parent.refresh[perspective]) refresh(board, parent, perspective);
+
+        const int kingSquare = board.kingSq(perspective).index();
+        const int16_t* added[2];
+        const int16_t* removed[2];
+        int addedCount = 0;
+        int removedCount = 0;
+
+        if (move.typeOf() == Move::CASTLING) {
+            // Only the opponent's view gets here; kings are not features, so just the rook moves
+            const bool kingSide = move.to() > move.from();
+            const Piece rook = board.at(move.to());
+            const int rookTo = Square::castling_rook_square(kingSide, board.sideToMove()).index();
+            removed[removedCount++] = featureColumn(featureIndex(perspective, kingSquare, rook, to));
+            added[addedCount++] = featureColumn(featureIndex(perspective, kingSquare, rook, rookTo));
+        } else {
+            const int captureSquare = move.typeOf() == Move::ENPASSANT ? to ^ 8 : to;
+            const Piece captured = board.at(Square(captureSquare));
+            if (captured != Piece::NONE) {
+                removed[removedCount++] = featureColumn(featureIndex(perspective, kingSquare, captured, captureSquare));
+            }
+            if (moved != PieceType::KING) {
+                const Piece placed = move.typeOf() == Move::PROMOTION ? Piece(move.promotionType(), board.sideToMove())
+                                                                      : moved;
+                removed[removedCount++] = featureColumn(featureIndex(perspective, kingSquare, moved, from));
+                added[addedCount++] = featureColumn(featureIndex(perspective, kingSquare, placed, to));
+            }
+        }
+
+        kernels.update(parent.values[perspective], child.values[perspective], added, addedCount, removed, removedCount);
+    }
+}
+
+int Nnue::evaluate(const Board& board, Accumulator& accumulator) {
+    for (int perspective = 0; perspective < 2; perspective++) {
+        if (accumulator.refresh[perspective]) refresh(board, accumulator, perspective);
+    }
+
+    const int us = board.sideToMove();
+    int64_t output = kernels.output(accumulator.values[us], accumulator.values[us ^ 1], network.outputWeights)
+                   + network.outputBias;
+    return static_cast<int>(output * evalScale / (activationMax * weightScale));
+}
+
+} // namespace chess
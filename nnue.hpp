@@ -0,0 +1,95 @@
+#ifndef NNUE_HPP
+#define NNUE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "chess.hpp"
+
+namespace chess {
+
+// Efficiently updatable neural network evaluator, an alternative to the handcrafted
+// Evaluation. The network is a HalfKP feature transformer into two accumulators, one per
+// perspective, followed by a clipped ReLU and a single int8 output layer.
+class Nnue {
+public:
+    // HalfKP: own king square x (5 non-king piece types x 2 colors) x piece square
+    static constexpr int pieceFeatures = 10;
+    static constexpr int inputs = 64 * pieceFeatures * 64;
+    static constexpr int hidden = 256;
+
+    // Accumulator values are clipped to [0, activationMax] before the output layer, whose int8
+    // weights are scaled by weightScale; the result maps to centipawns through evalScale
+    static constexpr int activationMax = 127;
+    static constexpr int weightScale = 64;
+    static constexpr int evalScale = 400;
+
+    struct alignas(64) Accumulator {
+        int16_t values[2][hidden];   // Indexed by perspective, white = 0
+        bool refresh[2] = {false, false}; // Perspective's king just moved, rebuild from the board on first use
+    };
+
+    /**
+     * Maps a network file into memory, replacing the current network on success
+     * @param path Path of the network file
+     * @return False if the file is missing, truncated or has a different architecture
+     */
+    static bool load(const std::string& path);
+
+    /**
+     * Installs a network with random weights, for benchmarking inference without a file
+     * @param seed Seed of the weight generator
+     */
+    static void loadRandom(uint64_t seed);
+
+    static void unload();
+    static bool loaded();
+    static const std::string& fileName();
+
+    // Name of the inference kernels in use: "avx2", "sse4.1" or "scalar". The fastest one the
+    // CPU supports is picked at startup; useKernel() overrides it, e.g. to compare them in bench
+    static const char* kernel();
+    static std::vector<std::string> kernelNames();
+    static bool useKernel(const std::string& name);
+
+    /**
+     * Rebuilds one perspective of an accumulator from the pieces on the board
+     * @param board The board to summarise
+     * @param accumulator Accumulator to fill
+     * @param perspective Color whose view of the board is rebuilt
+     */
+    static void refresh(const Board& board, Accumulator& accumulator, int perspective);
+
+    /**
+     * Derives the accumulator after a move from the one before it, call before making the move.
+     * A parent perspective still waiting for its refresh is rebuilt first, so only the king
+     * move's own child is ever flagged and everything below it updates incrementally
+     * @param board Board before the move
+     * @param move Move about to be made
+     * @param parent Accumulator of the board before the move
+     * @param child Accumulator to fill for the board after the move
+     */
+    static void update(const Board& board, Move move, Accumulator& parent, Accumulator& child);
+
+    /**
+     * Runs the output layer, refreshing any perspective whose king has moved first
+     * @param board Board the accumulator belongs to
+     * @param accumulator Accumulator of the board
+     * @return Score in centipawns from the perspective of the side to move
+     */
+    static int evaluate(const Board& board, Accumulator& accumulator);
+
+    /**
+     * Index of a piece in the input layer as seen from one side
+     * @param perspective Color whose view is used, black sees the board mirrored vertically
+     * @param kingSquare Square of the perspective's king
+     * @param piece Non-king piece
+     * @param square Square the piece stands on
+     * @return Feature index below inputs
+     */
+    static int featureIndex(int perspective, int kingSquare, Piece piece, int square);
+};
+
+} // namespace chess
+
+#endif // NNUE_HPP
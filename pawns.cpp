@@ -0,0 +1,138 @@
+#include "pawns.hpp"
+
+namespace chess {
+
+namespace {
+
+constexpr uint64_t fileA = 0x0101010101010101ULL;
+constexpr uint64_t fileH = fileA << 7;
+
+uint64_t northFill(uint64_t b) {
+    b |= b << 8;
+    b |= b << 16;
+    b |= b << 32;
+    return b;
+}
+
+uint64_t southFill(uint64_t b) {
+    b |= b >> 8;
+    b |= b >> 16;
+    b |= b >> 32;
+    return b;
+}
+
+// Squares in front of the pawns on their own and adjacent files, from each side's point of view
+uint64_t frontSpans(uint64_t pawns, int color) {
+    uint64_t span = color == 0 ? northFill(pawns << 8) : southFill(pawns >> 8);
+    return span | ((span & ~fileA) >> 1) | ((span & ~fileH) << 1);
+}
+
+// The files either side of every square in the set
+uint64_t adjacentFiles(uint64_t b) {
+    return ((b & ~fileA) >> 1) | ((b & ~fileH) << 1);
+}
+
+uint64_t pawnAttacks(uint64_t pawns, int color) {
+    return adjacentFiles(color == 0 ? pawns << 8 : pawns >> 8);
+}
+
+int popcount(uint64_t b) {
+    return Bitboard(b).count();
+}
+
+} // namespace
+
+PawnHashTable::PawnHashTable() : entries(size) {}
+
+void PawnHashTable::clear() {
+    std::fill(entries.begin(), entries.end(), Entry());
+}
+
+const PawnHashTable::Entry& PawnHashTable::probe(uint64_t key, const Board& board) {
+    Entry& entry = entries[key & (size - 1)];
+    probes++;
+    if (entry.key == key) {
+        hits++;
+        return entry;
+    }
+    entry = evaluatePawns(board);
+    entry.key = key;
+    return entry;
+}
+
+uint64_t PawnHashTable::pawnKey(const Board& board) {
+    uint64_t key = 0;
+    for (int color = 0; color < 2; color++) {
+        Bitboard pawns = board.pieces(PieceType::PAWN, color);
+        while (!pawns.empty()) {
+            key ^= zobrist[color][pawns.pop()];
+        }
+    }
+    return key;
+}
+
+uint64_t PawnHashTable::pawnKeyAfter(uint64_t key, const Board& board, Move move) {
+    if (move.typeOf() == Move::CASTLING) return key;
+
+    const int us = static_cast<int>(board.sideToMove());
+    const int them = us ^ 1;
+    const int from = move.from().index();
+    const int to = move.to().index();
+
+    if (move.typeOf() == Move::ENPASSANT) {
+        key ^= zobrist[them][to ^ 8];
+    } else if (board.at<PieceType>(move.to()) == PieceType::PAWN) {
+        key ^= zobrist[them][to];
+    }
+
+    if (board.at<PieceType>(move.from()) == PieceType::PAWN) {
+        key ^= zobrist[us][from];
+        if (move.typeOf() != Move::PROMOTION) key ^= zobrist[us][to];
+    }
+    return key;
+}
+
+PawnHashTable::Entry PawnHashTable::evaluatePawns(const Board& board) {
+    Entry entry;
+    const uint64_t pawns[2] = {
+        board.pieces(PieceType::PAWN, Color::WHITE).getBits(),
+        board.pieces(PieceType::PAWN, Color::BLACK).getBits()
+    };
+    const uint64_t attacks[2] = { pawnAttacks(pawns[0], 0), pawnAttacks(pawns[1], 1) };
+
+    // Every term is a whole-board set operation followed by a popcount rather than a loop over pawns
+    for (int color = 0; color < 2; color++) {
+        const int them = color ^ 1;
+        const uint64_t own = pawns[color];
+        const uint64_t files = northFill(own) | southFill(own);
+        const uint64_t stops = color == 0 ? own << 8 : own >> 8;
+        // Squares own pawns attack now or could attack after advancing
+        const uint64_t attackSpans = color == 0 ? northFill(attacks[color]) : southFill(attacks[color]);
+
+        const uint64_t passed = own & ~frontSpans(pawns[them], them);
+        const uint64_t isolated = own & ~adjacentFiles(files);
+        const uint64_t doubled = own & (color == 0 ? southFill(own >> 8) : northFill(own << 8));
+        const uint64_t connected = own & (attacks[color] | adjacentFiles(own));
+        // Stop square controlled by an enemy pawn and out of reach of any own pawn's support
+        const uint64_t backwardStops = stops & attacks[them] & ~attackSpans;
+        const uint64_t backward = (color == 0 ? backwardStops >> 8 : backwardStops << 8) & ~isolated;
+
+        // Passed pawns are rare enough that visiting them beats a popcount per rank
+        int value = 0;
+        Bitboard passers = passed;
+        while (!passers.empty()) {
+            const int rank = passers.pop() / 8;
+            value += passedPawnBonus[color == 0 ? rank : 7 - rank];
+        }
+        value -= popcount(isolated) * isolatedPenalty;
+        value -= popcount(doubled) * doubledPenalty;
+        value -= popcount(backward) * backwardPenalty;
+        value += popcount(connected) * connectedBonus;
+
+        entry.passed[color] = passed;
+        entry.score += color == 0 ? value : -value;
+    }
+    return entry;
+}
+
+} // namespace chess
@@ -0,0 +1,90 @@
+#ifndef PAWNS_HPP
+#define PAWNS_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "chess.hpp"
+
+namespace chess {
+
+class PawnHashTable {
+public:
+    struct Entry {
+        uint64_t key = 0;
+        int score = 0;               // Pawn structure score from white's perspective
+        uint64_t passed[2] = {0, 0}; // Passed pawns per color
+    };
+
+    PawnHashTable();
+
+    /**
+     * Returns the cached pawn structure for the board, evaluating and storing it on a miss
+     * @param key Pawn key of the board, see pawnKey()
+     * @param board Board whose pawns are evaluated on a miss
+     * @return Entry for the board's pawn structure
+     */
+    const Entry& probe(uint64_t key, const Board& board);
+
+    void clear();
+
+    /**
+     * Computes the pawn-only Zobrist key of a board from scratch
+     * @param board The board to hash
+     * @return Key depending only on the placement of both sides' pawns
+     */
+    static uint64_t pawnKey(const Board& board);
+
+    /**
+     * Updates a pawn key for a move, must be called before the move is made on the board
+     * @param key Pawn key of the board before the move
+     * @param board Board before the move
+     * @param move Move about to be made
+     * @return Pawn key of the board after the move
+     */
+    static uint64_t pawnKeyAfter(uint64_t key, const Board& board, Move move);
+
+    /**
+     * Evaluates passed, isolated, doubled, backward and connected pawns of a board
+     * without touching the table
+     * @param board The board to evaluate
+     * @return Entry with key left unset
+     */
+    static Entry evaluatePawns(const Board& board);
+
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+
+    // A few thousand entries are enough, pawn structures change rarely within a search
+    static constexpr size_t size = 1 << 14;
+
+    // Indexed by rank from the pawn's own side
+    static constexpr int passedPawnBonus[8] = { 0, 10, 15, 25, 40, 60, 90, 0 };
+    static constexpr int isolatedPenalty = 15;
+    static constexpr int doubledPenalty = 10;   // Per pawn with a friendly pawn in front of it
+    static constexpr int backwardPenalty = 8;
+    static constexpr int connectedBonus = 5;    // Per pawn defended by or beside a friendly pawn
+
+    static constexpr std::array<std::array<uint64_t, 64>, 2> zobrist = []() constexpr {
+        std::array<std::array<uint64_t, 64>, 2> keys{};
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        for (int color = 0; color < 2; color++) {
+            for (int square = 0; square < 64; square++) {
+                // splitmix64
+                state += 0x9E3779B97F4A7C15ULL;
+                uint64_t z = state;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                keys[color][square] = z ^ (z >> 31);
+            }
+        }
+        return keys;
+    }();
+
+private:
+    std::vector<Entry> entries;
+};
+
+} // namespace chess
+
+#endif // PAWNS_HPP
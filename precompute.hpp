@@ -2,33 +2,201 @@
 #define PRECOMPUTED_MOVE_DATA_HPP
 
 #include <array>
-#include <vector>
 #include <cstdint>
 #include "chess.hpp"
 
 namespace chess {
 
+// Fixed-capacity list of target squares, iterated like the vectors it replaces
+template <int Capacity>
+struct SquareList {
+    std::array<uint8_t, Capacity> squares{};
+    uint8_t count = 0;
+
+    constexpr void push(int square) { squares[count++] = static_cast<uint8_t>(square); }
+    constexpr int size() const { return count; }
+    constexpr const uint8_t* begin() const { return squares.data(); }
+    constexpr const uint8_t* end() const { return squares.data() + count; }
+};
+
+// Compile-time generators for the PrecomputedMoveData tables
+namespace detail {
+
+constexpr int absolute(int x) { return x < 0 ? -x : x; }
+constexpr int minimum(int a, int b) { return a < b ? a : b; }
+constexpr int maximum(int a, int b) { return a > b ? a : b; }
+
+// Directions in the order numSquaresToEdge and rays use: N, S, W, E, NW, SE, NE, SW. Each
+// direction's opposite is its index xor 1
+constexpr int directionOffsets[8] = { 8, -8, -1, 1, 7, -7, 9, -9 };
+
+constexpr std::array<std::array<uint8_t, 8>, 64> generateSquaresToEdge() {
+    std::array<std::array<uint8_t, 8>, 64> table{};
+    for (int square = 0; square < 64; square++) {
+        int north = 7 - square / 8;
+        int south = square / 8;
+        int west = square % 8;
+        int east = 7 - square % 8;
+        int edges[8] = { north, south, west, east,
+                         minimum(north, west),
+                         minimum(south, east),
+                         minimum(north, east),
+                         minimum(south, west) };
+        for (int direction = 0; direction < 8; direction++) {
+            table[square][direction] = static_cast<uint8_t>(edges[direction]);
+        }
+    }
+    return table;
+}
+
+// Squares a leaper reaches from each square, jumps that wrap around the board are dropped
+template <int Count>
+constexpr std::array<SquareList<8>, 64> generateLeaperMoves(const int (&jumps)[Count], int reach) {
+    std::array<SquareList<8>, 64> table{};
+    for (int square = 0; square < 64; square++) {
+        for (int jump : jumps) {
+            int target = square + jump;
+            if (target < 0 || target >= 64) continue;
+            if (maximum(absolute(square % 8 - target % 8), absolute(square / 8 - target / 8)) == reach) {
+                table[square].push(target);
+            }
+        }
+    }
+    return table;
+}
+
+constexpr int knightJumps[] = { 15, 17, -17, -15, 10, -6, 6, -10 };
+constexpr int kingSteps[] = { 8, -8, -1, 1, 7, -7, 9, -9 };
+
+constexpr std::array<SquareList<2>, 64> generatePawnAttacks(bool white) {
+    std::array<SquareList<2>, 64> table{};
+    for (int square = 0; square < 64; square++) {
+        int x = square % 8;
+        int y = square / 8;
+        if (white ? y == 7 : y == 0) continue;
+        if (x > 0) table[square].push(white ? square + 7 : square - 9);
+        if (x < 7) table[square].push(white ? square + 9 : square - 7);
+    }
+    return table;
+}
+
+constexpr std::array<uint64_t, 64> generateAttackBitboards(const std::array<SquareList<8>, 64>& moves) {
+    std::array<uint64_t, 64> table{};
+    for (int square = 0; square < 64; square++) {
+        for (int target : moves[square]) table[square] |= 1ULL << target;
+    }
+    return table;
+}
+
+constexpr std::array<std::array<uint8_t, 64>, 64> generateDistances(bool chebyshev) {
+    std::array<std::array<uint8_t, 64>, 64> table{};
+    for (int squareA = 0; squareA < 64; squareA++) {
+        for (int squareB = 0; squareB < 64; squareB++) {
+            int rankDist = absolute(squareA / 8 - squareB / 8);
+            int fileDist = absolute(squareA % 8 - squareB % 8);
+            table[squareA][squareB] = static_cast<uint8_t>(chebyshev ? maximum(fileDist, rankDist) : fileDist + rankDist);
+        }
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, 64> generateCentreManhattanDistance() {
+    std::array<uint8_t, 64> table{};
+    for (int square = 0; square < 64; square++) {
+        int rank = square / 8;
+        int file = square % 8;
+        table[square] = static_cast<uint8_t>(maximum(3 - file, file - 4) + maximum(3 - rank, rank - 4));
+    }
+    return table;
+}
+
+constexpr std::array<std::array<uint64_t, 2>, 64> generatePawnAttackBitboards(
+    const std::array<SquareList<2>, 64>& white, const std::array<SquareList<2>, 64>& black) {
+    std::array<std::array<uint64_t, 2>, 64> table{};
+    for (int square = 0; square < 64; square++) {
+        for (int target : white[square]) table[square][0] |= 1ULL << target;
+        for (int target : black[square]) table[square][1] |= 1ULL << target;
+    }
+    return table;
+}
+
+// Squares from each square to the edge of the board in each direction, the square itself excluded
+constexpr std::array<std::array<uint64_t, 64>, 8> generateRays() {
+    std::array<std::array<uint64_t, 64>, 8> table{};
+    constexpr auto squaresToEdge = generateSquaresToEdge();
+    for (int direction = 0; direction < 8; direction++) {
+        for (int square = 0; square < 64; square++) {
+            for (int step = 1; step <= squaresToEdge[square][direction]; step++) {
+                table[direction][square] |= 1ULL << (square + directionOffsets[direction] * step);
+            }
+        }
+    }
+    return table;
+}
+
+// Slider moves on an empty board: the union of the rays in directions [first, last)
+constexpr std::array<uint64_t, 64> generateSliderMoves(const std::array<std::array<uint64_t, 64>, 8>& rays,
+                                                       int first, int last) {
+    std::array<uint64_t, 64> table{};
+    for (int square = 0; square < 64; square++) {
+        for (int direction = first; direction < last; direction++) table[square] |= rays[direction][square];
+    }
+    return table;
+}
+
+// between: squares strictly between two aligned squares. line: the whole line through them,
+// edge to edge. Both are empty for squares that do not share a rank, file or diagonal
+constexpr std::array<std::array<uint64_t, 64>, 64> generateLines(const std::array<std::array<uint64_t, 64>, 8>& rays,
+                                                                 bool fullLine) {
+    std::array<std::array<uint64_t, 64>, 64> table{};
+    for (int from = 0; from < 64; from++) {
+        for (int direction = 0; direction < 8; direction++) {
+            uint64_t ray = rays[direction][from];
+            for (int to = 0; to < 64; to++) {
+                if (!(ray >> to & 1)) continue;
+                table[from][to] = fullLine
+                    ? ray | rays[direction ^ 1][from] | 1ULL << from
+                    : ray & ~rays[direction][to] & ~(1ULL << to);
+            }
+        }
+    }
+    return table;
+}
+
+} // namespace detail
+
+// Tables are generated at compile time, so there is nothing to initialise at startup
 class PrecomputedMoveData {
 public:
-    static void initialize();
-    static int numRookMovesToReachSquare(int startSquare, int targetSquare);
-    static int numKingMovesToReachSquare(int startSquare, int targetSquare);
-
-    static std::array<std::array<int, 8>, 64> numSquaresToEdge;
-    static std::array<std::vector<uint8_t>, 64> knightMoves;
-    static std::array<std::vector<uint8_t>, 64> kingMoves;
-    static std::array<std::vector<int>, 64> pawnAttacksWhite;
-    static std::array<std::vector<int>, 64> pawnAttacksBlack;
-    static std::array<int, 127> directionLookup;
-    static std::array<uint64_t, 64> kingAttackBitboards;
-    static std::array<uint64_t, 64> knightAttackBitboards;
-    static std::array<std::array<uint64_t, 2>, 64> pawnAttackBitboards;
-    static std::array<uint64_t, 64> rookMoves;
-    static std::array<uint64_t, 64> bishopMoves;
-    static std::array<uint64_t, 64> queenMoves;
-    static std::array<std::array<int, 64>, 64> orthogonalDistance;
-    static std::array<std::array<int, 64>, 64> kingDistance;
-    static std::array<int, 64> centreManhattanDistance;
+    static constexpr int numRookMovesToReachSquare(int startSquare, int targetSquare) {
+        return orthogonalDistance[startSquare][targetSquare];
+    }
+    static constexpr int numKingMovesToReachSquare(int startSquare, int targetSquare) {
+        return kingDistance[startSquare][targetSquare];
+    }
+
+    static constexpr std::array<std::array<uint8_t, 8>, 64> numSquaresToEdge = detail::generateSquaresToEdge();
+    static constexpr std::array<SquareList<8>, 64> knightMoves = detail::generateLeaperMoves(detail::knightJumps, 2);
+    static constexpr std::array<SquareList<8>, 64> kingMoves = detail::generateLeaperMoves(detail::kingSteps, 1);
+    static constexpr std::array<SquareList<2>, 64> pawnAttacksWhite = detail::generatePawnAttacks(true);
+    static constexpr std::array<SquareList<2>, 64> pawnAttacksBlack = detail::generatePawnAttacks(false);
+    static constexpr std::array<uint64_t, 64> kingAttackBitboards = detail::generateAttackBitboards(kingMoves);
+    static constexpr std::array<uint64_t, 64> knightAttackBitboards = detail::generateAttackBitboards(knightMoves);
+    // Indexed by square, then color: white = 0
+    static constexpr std::array<std::array<uint64_t, 2>, 64> pawnAttackBitboards =
+        detail::generatePawnAttackBitboards(pawnAttacksWhite, pawnAttacksBlack);
+
+    // Indexed by direction (see detail::directionOffsets), then square
+    static constexpr std::array<std::array<uint64_t, 64>, 8> rays = detail::generateRays();
+    static constexpr std::array<uint64_t, 64> rookMoves = detail::generateSliderMoves(rays, 0, 4);
+    static constexpr std::array<uint64_t, 64> bishopMoves = detail::generateSliderMoves(rays, 4, 8);
+    static constexpr std::array<uint64_t, 64> queenMoves = detail::generateSliderMoves(rays, 0, 8);
+    static constexpr std::array<std::array<uint64_t, 64>, 64> between = detail::generateLines(rays, false);
+    static constexpr std::array<std::array<uint64_t, 64>, 64> line = detail::generateLines(rays, true);
+
+    static constexpr std::array<std::array<uint8_t, 64>, 64> orthogonalDistance = detail::generateDistances(false);
+    static constexpr std::array<std::array<uint8_t, 64>, 64> kingDistance = detail::generateDistances(true);
+    static constexpr std::array<uint8_t, 64> centreManhattanDistance = detail::generateCentreManhattanDistance();
 };
 
 } // namespace chess
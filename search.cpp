@@ -0,0 +1,229 @@
+#include "search.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace chess {
+
+Search::Search(Board board, AISettings settings, TranspositionTable& transposition)
+    : settings(settings), board_(board), transposition_(transposition) {}
+
+void Search::reset() {
+    stopped_.store(false, std::memory_order_relaxed);
+    nodes_.store(0, std::memory_order_relaxed);
+    completedDepth_ = 0;
+    bestMove_ = Move::NO_MOVE;
+    bestEval_ = 0;
+}
+
+void Search::startSearch(const Board& board) {
+    using clock = std::chrono::steady_clock;
+
+    board_ = board;
+    evaluation_.setPosition(board_);
+
+    // Mated or stalemated at the root: there is no move to report, only the result
+    Movelist rootMoves;
+    movegen::legalmoves(rootMoves, board_);
+    if (rootMoves.empty()) {
+        bestEval_ = board_.inCheck() ? -mateScore : 0;
+        if (settings.printInfo) std::cout << "info depth 0 score " << scoreToUci(bestEval_) << std::endl;
+        return;
+    }
+
+    auto start = clock::now();
+    const int firstDepth = settings.useIterativeDeepening ? 1 : settings.depth;
+    for (int depth = firstDepth; depth <= settings.depth; depth++) {
+        if (settings.skipSize > 0 && depth < settings.depth && (depth + settings.skipPhase) / settings.skipSize % 2) {
+            continue;
+        }
+        int eval = pvs(depth, 0, -infinity, infinity);
+        // An interrupted iteration's best move may not have been compared with the others
+        if (stopped_.load(std::memory_order_relaxed)) break;
+
+        completedDepth_ = depth;
+        bestEval_ = eval;
+        if (pvLength_[0] > 0) bestMove_ = pv_[0][0];
+
+        if (settings.printInfo) {
+            double seconds = std::chrono::duration<double>(clock::now() - start).count();
+            const uint64_t nodes = nodeCounter_ ? nodeCounter_() : this->nodes();
+            std::cout << "info depth " << depth << " score " << scoreToUci(eval) << " nodes " << nodes
+                      << " nps " << static_cast<uint64_t>(seconds > 0 ? nodes / seconds : 0)
+                      << " time " << static_cast<int64_t>(seconds * 1000)
+                      << " hashfull " << transposition_.hashfull() << " pv";
+            for (int i = 0; i < pvLength_[0]; i++) std::cout << " " << uci::moveToUci(pv_[0][i]);
+            std::cout << std::endl;
+        }
+
+        // Nothing deeper can change a forced mate found within the horizon
+        if (isMateScore(eval)) break;
+    }
+
+    // A search stopped during its first iteration still has to return a legal move
+    if (bestMove_ == Move::NO_MOVE) bestMove_ = rootMoves[0];
+}
+
+void Search::stop() {
+    stopped_.store(true, std::memory_order_relaxed);
+}
+
+std::pair<Move, int> Search::getSearchResult() const {
+    return {bestMove_, bestEval_};
+}
+
+bool Search::isMateScore(int score) {
+    return std::abs(score) >= mateScore - maxPly;
+}
+
+int Search::pvs(int depth, int ply, int alpha, int beta) {
+    const bool pvNode = beta - alpha > 1;
+    pvLength_[ply] = 0;
+
+    if (ply > 0 && (board_.isRepetition(1) || board_.isHalfMoveDraw() || board_.isInsufficientMaterial())) {
+        return 0;
+    }
+    if (ply >= maxPly - 1) return evaluation_.evaluate(board_);
+
+    const bool inCheck = board_.inCheck();
+    if (inCheck) depth++;
+    if (depth <= 0) return quiescence(ply, alpha, beta);
+
+    countNode();
+    if (stopped_.load(std::memory_order_relaxed)) return 0;
+
+    // Bounds are only trusted off the principal variation, so the PV is always searched in full
+    const uint64_t hash = board_.hash();
+    int ttScore = transposition_.lookupEvaluation(depth, ply, alpha, beta, hash);
+    if (!pvNode && ttScore != TranspositionTable::lookupFailed) return ttScore;
+
+    Movelist moves;
+    movegen::legalmoves(moves, board_);
+    if (moves.empty()) return inCheck ? -mateScore + ply : 0;
+    scoreMoves(moves, transposition_.getStoredMove(hash));
+
+    int bestScore = -infinity;
+    Move bestMove = Move::NO_MOVE;
+    int nodeType = TranspositionTable::upperBound;
+
+    for (int i = 0; i < moves.size(); i++) {
+        const Move move = pickMove(moves, i);
+        evaluation_.makeMove(board_, move);
+        board_.makeMove(move);
+        transposition_.prefetch(board_.hash());
+
+        // Later moves only get a full window if a null window shows they beat the first one
+        int score;
+        if (i == 0) {
+            score = -pvs(depth - 1, ply + 1, -beta, -alpha);
+        } else {
+            score = -pvs(depth - 1, ply + 1, -alpha - 1, -alpha);
+            if (score > alpha && score < beta) score = -pvs(depth - 1, ply + 1, -beta, -alpha);
+        }
+
+        board_.unmakeMove(move);
+        evaluation_.unmakeMove();
+        if (stopped_.load(std::memory_order_relaxed)) return 0;
+
+        if (score > bestScore) {
+            bestScore = score;
+            bestMove = move;
+            if (score > alpha) {
+                alpha = score;
+                nodeType = TranspositionTable::exact;
+                updatePv(ply, move);
+                if (alpha >= beta) {
+                    nodeType = TranspositionTable::lowerBound;
+                    break;
+                }
+            }
+        }
+    }
+
+    transposition_.storeEvaluation(depth, ply, bestScore, nodeType, bestMove, hash);
+    return bestScore;
+}
+
+int Search::quiescence(int ply, int alpha, int beta) {
+    countNode();
+    pvLength_[ply] = 0;
+    if (ply >= maxPly - 1) return evaluation_.evaluate(board_);
+
+    // Only whether the stand pat clears the window matters, so the lazy evaluation is enough
+    int bestScore = evaluation_.evaluate(board_, alpha, beta);
+    if (bestScore >= beta) return bestScore;
+    alpha = std::max(alpha, bestScore);
+
+    Movelist captures;
+    movegen::legalmoves<movegen::MoveGenType::CAPTURE>(captures, board_);
+    scoreMoves(captures, Move::NO_MOVE);
+
+    for (int i = 0; i < captures.size(); i++) {
+        const Move move = pickMove(captures, i);
+        evaluation_.makeMove(board_, move);
+        board_.makeMove(move);
+        int score = -quiescence(ply + 1, -beta, -alpha);
+        board_.unmakeMove(move);
+        evaluation_.unmakeMove();
+
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) {
+                alpha = score;
+                updatePv(ply, move);
+                if (alpha >= beta) break;
+            }
+        }
+    }
+    return bestScore;
+}
+
+void Search::scoreMoves(Movelist& moves, Move ttMove) {
+    bool ttMoveFound = false;
+    for (Move& move : moves) {
+        int score = 0;
+        if (move == ttMove) {
+            score = 30000;
+            ttMoveFound = true;
+        } else if (move.typeOf() == Move::ENPASSANT) {
+            score = 10000 + 100 * static_cast<int>(PieceType::PAWN) - static_cast<int>(PieceType::PAWN);
+        } else if (move.typeOf() != Move::CASTLING && board_.at(move.to()) != Piece::NONE) {
+            // Castling is encoded as the king capturing its own rook
+            const int victim = static_cast<int>(board_.at<PieceType>(move.to()).internal());
+            const int attacker = static_cast<int>(board_.at<PieceType>(move.from()).internal());
+            score = 10000 + 100 * victim - attacker;
+        }
+        if (move.typeOf() == Move::PROMOTION) {
+            score += 5000 + static_cast<int>(move.promotionType().internal());
+        }
+        move.setScore(static_cast<int16_t>(std::min(score, 30000)));
+    }
+
+    // A stored move that is not legal here was written by a different position with the same key bits
+    if (ttMove != Move::NO_MOVE && !ttMoveFound) transposition_.reportCollision();
+}
+
+Move Search::pickMove(Movelist& moves, int index) {
+    int best = index;
+    for (int i = index + 1; i < moves.size(); i++) {
+        if (moves[i].score() > moves[best].score()) best = i;
+    }
+    std::swap(moves[index], moves[best]);
+    return moves[index];
+}
+
+void Search::updatePv(int ply, Move move) {
+    pv_[ply][0] = move;
+    const int childLength = ply + 1 < maxPly ? pvLength_[ply + 1] : 0;
+    for (int i = 0; i < childLength; i++) pv_[ply][i + 1] = pv_[ply + 1][i];
+    pvLength_[ply] = childLength + 1;
+}
+
+std::string Search::scoreToUci(int score) const {
+    if (!isMateScore(score)) return "cp " + std::to_string(score);
+    const int plies = mateScore - std::abs(score);
+    const int moves = (plies + 1) / 2;
+    return "mate " + std::to_string(score > 0 ? moves : -moves);
+}
+
+} // namespace chess
@@ -0,0 +1,112 @@
+#ifndef SEARCH_HPP
+#define SEARCH_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include "chess.hpp"
+#include "evaluation.hpp"
+#include "transposition.hpp"
+
+namespace chess {
+
+struct AISettings {
+    int depth;                          // Maximum search depth in plies
+    bool useIterativeDeepening = false; // Search every depth up to `depth` rather than only the last
+    bool printInfo = true;              // Print UCI info lines; off for Lazy SMP helpers
+    // Lazy SMP helpers skip iterations on a schedule of their own, so the threads are spread over
+    // different depths instead of searching each one together: depth d is skipped when
+    // (d + skipPhase) / skipSize is odd. 0 searches every depth, and the last one is never skipped
+    int skipSize = 0;
+    int skipPhase = 0;
+};
+
+// Principal variation search with iterative deepening. Every full-width node probes and stores
+// the transposition table and tries the stored move first; leaves are resolved by a captures-only
+// quiescence search that stands pat on the lazy evaluation.
+class Search {
+public:
+    // Mates are scored mateScore minus the plies to mate. The transposition table adds up to
+    // maxPly on store, which still fits its 16-bit values
+    static constexpr int mateScore = 30000;
+    static constexpr int maxPly = 128;
+    static constexpr int infinity = mateScore + 1;
+
+    AISettings settings;
+
+    Search(Board board, AISettings settings, TranspositionTable& transposition);
+
+    /**
+     * Clears the stop flag and the previous result. Called by the thread that starts the search,
+     * before it hands the search to its worker, so a stop sent straight after is never lost
+     */
+    void reset();
+
+    /**
+     * Searches a position, printing UCI info after each completed iteration. Call reset() first.
+     * With no legal moves at the root the result is NO_MOVE with the mate or draw score
+     * @param board Position to search
+     */
+    void startSearch(const Board& board);
+
+    /**
+     * Makes a running search return as soon as possible, safe to call from another thread.
+     * The result of the last completed iteration is kept
+     */
+    void stop();
+
+    /**
+     * Result of the last completed iteration
+     * @return Best move and its score from the perspective of the side to move
+     */
+    std::pair<Move, int> getSearchResult() const;
+
+    /**
+     * Sets where the node count on info lines comes from, so a Lazy SMP main search can report
+     * every thread's nodes. Defaults to this search's own
+     * @param counter Called once per info line
+     */
+    void setNodeCounter(std::function<uint64_t()> counter) { nodeCounter_ = std::move(counter); }
+
+    uint64_t nodes() const { return nodes_.load(std::memory_order_relaxed); }
+    int completedDepth() const { return completedDepth_; }
+
+    static bool isMateScore(int score);
+
+private:
+    Board board_;
+    TranspositionTable& transposition_;
+    Evaluation evaluation_;
+    std::atomic<bool> stopped_{false};
+
+    // Only this thread writes it, but other threads read it for their info lines
+    std::atomic<uint64_t> nodes_{0};
+    std::function<uint64_t()> nodeCounter_;
+    int completedDepth_ = 0;
+    Move bestMove_ = Move::NO_MOVE;
+    int bestEval_ = 0;
+
+    // Triangular principal variation table: row ply holds the line from ply onwards
+    Move pv_[maxPly][maxPly];
+    int pvLength_[maxPly];
+
+    // A plain load and store rather than a locked increment, as no other thread writes nodes_
+    void countNode() { nodes_.store(nodes_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+    int pvs(int depth, int ply, int alpha, int beta);
+    int quiescence(int ply, int alpha, int beta);
+
+    // Scores moves for ordering: the TT move first, then captures by MVV-LVA, then promotions
+    void scoreMoves(Movelist& moves, Move ttMove);
+    // Swaps the best scored move from index onwards into index
+    static Move pickMove(Movelist& moves, int index);
+
+    void updatePv(int ply, Move move);
+    std::string scoreToUci(int score) const;
+};
+
+} // namespace chess
+
+#endif // SEARCH_HPP
@@ -0,0 +1,105 @@
+#include "sliders.hpp"
+#include "precompute.hpp"
+
+namespace chess {
+
+namespace {
+
+// Every subset of every square's relevant occupancy: 2^(popcount of the mask) entries per square
+constexpr int bishopTableSize = 5248;
+constexpr int rookTableSize = 102400;
+
+uint64_t bishopTable[bishopTableSize];
+uint64_t rookTable[rookTableSize];
+
+// Attacks along the given directions, each ray cut at its first blocker. Built from
+// PrecomputedMoveData rather than chess::attacks so the two backends are checked independently
+uint64_t rayAttacks(int square, uint64_t occupied, int firstDirection, int lastDirection) {
+    uint64_t result = 0;
+    for (int direction = firstDirection; direction < lastDirection; direction++) {
+        const uint64_t ray = PrecomputedMoveData::rays[direction][square];
+        const Bitboard blockers(ray & occupied);
+        if (blockers.empty()) {
+            result |= ray;
+            continue;
+        }
+        const int blocker = detail::directionOffsets[direction] > 0 ? blockers.lsb() : blockers.msb();
+        result |= ray ^ PrecomputedMoveData::rays[direction][blocker];
+    }
+    return result;
+}
+
+uint64_t relevantOccupancy(int square, int firstDirection, int lastDirection) {
+    uint64_t mask = 0;
+    for (int direction = firstDirection; direction < lastDirection; direction++) {
+        const int length = PrecomputedMoveData::numSquaresToEdge[square][direction];
+        if (length == 0) continue;
+        const int edge = square + detail::directionOffsets[direction] * length;
+        mask |= PrecomputedMoveData::rays[direction][square] & ~(1ULL << edge);
+    }
+    return mask;
+}
+
+// Fills one piece type's tables, rooks moving along directions 0-3 and bishops along 4-7
+template <typename Entry>
+void initialize(Entry (&entries)[64], uint64_t* table, int firstDirection, int lastDirection) {
+    uint64_t* next = table;
+    for (int square = 0; square < 64; square++) {
+        const uint64_t mask = relevantOccupancy(square, firstDirection, lastDirection);
+        entries[square] = {mask, next};
+
+        // Walks the subsets of the mask in increasing order, which is also their PEXT index
+        uint64_t subset = 0;
+        do {
+            *next++ = rayAttacks(square, subset, firstDirection, lastDirection);
+            subset = (subset - mask) & mask;
+        } while (subset);
+    }
+}
+
+bool pextSupported() {
+#if defined(SLIDERS_PEXT)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2");
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+Sliders::Entry Sliders::bishopEntries[64];
+Sliders::Entry Sliders::rookEntries[64];
+bool Sliders::usePext = Sliders::initializePext();
+
+bool Sliders::initializePext() {
+    if (!pextSupported()) return false;
+    initialize(bishopEntries, bishopTable, 4, 8);
+    initialize(rookEntries, rookTable, 0, 4);
+    return true;
+}
+
+const char* Sliders::backend() {
+    return usePext ? "pext" : "magic";
+}
+
+std::vector<std::string> Sliders::backendNames() {
+    std::vector<std::string> names;
+    if (pextSupported()) names.push_back("pext");
+    names.push_back("magic");
+    return names;
+}
+
+bool Sliders::useBackend(const std::string& name) {
+    if (name == "magic") {
+        usePext = false;
+        return true;
+    }
+    if (name == "pext" && pextSupported()) {
+        usePext = true;
+        return true;
+    }
+    return false;
+}
+
+} // namespace chess
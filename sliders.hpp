@@ -0,0 +1,80 @@
+#ifndef SLIDERS_HPP
+#define SLIDERS_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "chess.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SLIDERS_PEXT
+#endif
+
+namespace chess {
+
+// Rook and bishop attack lookups with a choice of backend. chess::attacks indexes its tables by
+// magic multiplication; on CPUs with BMI2 the PEXT backend extracts the index from the occupancy
+// directly. The fastest backend the CPU supports is picked at startup, magic being the fallback.
+class Sliders {
+public:
+    static Bitboard bishop(Square square, Bitboard occupied);
+    static Bitboard rook(Square square, Bitboard occupied);
+    static Bitboard queen(Square square, Bitboard occupied);
+
+    // Name of the backend in use: "pext" or "magic". useBackend() overrides the startup choice,
+    // e.g. to compare them in bench
+    static const char* backend();
+    static std::vector<std::string> backendNames();
+    static bool useBackend(const std::string& name);
+
+private:
+    struct Entry {
+        uint64_t mask;         // Relevant occupancy, the edge squares of each ray left out
+        const uint64_t* attacks;
+    };
+
+    static bool usePext;
+    static Entry bishopEntries[64];
+    static Entry rookEntries[64];
+
+    // Builds the PEXT tables if the CPU supports BMI2, run once during static initialization
+    static bool initializePext();
+
+    static uint64_t pext(uint64_t bits, uint64_t mask) {
+#if defined(SLIDERS_PEXT)
+        // Inline assembly rather than _pext_u64 so the lookups inline into code built without
+        // -mbmi2; it only runs once the CPU has been checked for BMI2
+        uint64_t result;
+        asm("pextq %2, %1, %0" : "=r"(result) : "r"(bits), "r"(mask));
+        return result;
+#else
+        (void)bits;
+        (void)mask;
+        return 0;
+#endif
+    }
+};
+
+inline Bitboard Sliders::bishop(Square square, Bitboard occupied) {
+    if (usePext) {
+        const Entry& entry = bishopEntries[square.index()];
+        return Bitboard(entry.attacks[pext(occupied.getBits(), entry.mask)]);
+    }
+    return attacks::bishop(square, occupied);
+}
+
+inline Bitboard Sliders::rook(Square square, Bitboard occupied) {
+    if (usePext) {
+        const Entry& entry = rookEntries[square.index()];
+        return Bitboard(entry.attacks[pext(occupied.getBits(), entry.mask)]);
+    }
+    return attacks::rook(square, occupied);
+}
+
+inline Bitboard Sliders::queen(Square square, Bitboard occupied) {
+    return bishop(square, occupied) | rook(square, occupied);
+}
+
+} // namespace chess
+
+#endif // SLIDERS_HPP
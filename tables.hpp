@@ -7,15 +7,14 @@ namespace chess {
 
 class PieceSquareTable {
 public:
-    static int read(const int* table, int square, bool isWhite) {
-        if (isWhite) {
-            int file = square % 8;
-            int rank = square / 8;
-            rank = 7 - rank;
-            square = rank * 8 + file;
-        }
-        return table[square];
-    }
+    // Piece values and mop-up weights are tuned together with the tables, so they live here too
+    static constexpr int pawnValue = 100;
+    static constexpr int knightValue = 300;
+    static constexpr int bishopValue = 320;
+    static constexpr int rookValue = 500;
+    static constexpr int queenValue = 900;
+    static constexpr int mopUpCentreWeight = 10;
+    static constexpr int mopUpDistanceWeight = 4;
 
     static constexpr int pawns[] = {
         0,  0,  0,  0,  0,  0,  0,  0,
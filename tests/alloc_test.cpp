@@ -0,0 +1,96 @@
+// Checks that searching does not touch the heap. Global operator new and delete are replaced
+// with counting versions; a fixed-depth search of every position warms up the buffers, then the
+// same searches run again with counting on and the program fails if any of them allocated.
+//
+// Build from the repository root:
+//   g++ -std=c++17 -O2 -pthread tests/alloc_test.cpp search.cpp transposition.cpp evaluation.cpp pawns.cpp nnue.cpp sliders.cpp -o wb-alloc-test
+//
+// Usage:
+//   wb-alloc-test [depth]
+//
+// Exits with 1 if any allocation happened after setup.
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+#include "../search.hpp"
+#include "../transposition.hpp"
+
+namespace {
+
+std::atomic<bool> counting{false};
+std::atomic<uint64_t> allocations{0};
+
+void* allocate(std::size_t size, std::size_t alignment) {
+    if (counting.load(std::memory_order_relaxed)) allocations.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) size = 1;
+    void* memory = alignment <= alignof(std::max_align_t)
+        ? std::malloc(size)
+        : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+// Openings, middlegames and an endgame, so the search sees captures, promotions and checks
+const char* positions[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r2q1rk1/pp2ppbp/2p2np1/6B1/3PP1b1/Q1P2N2/P4PPP/3RKB1R b K - 0 13",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"
+};
+
+} // namespace
+
+void* operator new(std::size_t size) { return allocate(size, alignof(std::max_align_t)); }
+void* operator new[](std::size_t size) { return allocate(size, alignof(std::max_align_t)); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocate(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocate(size, static_cast<std::size_t>(alignment)); }
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+
+using namespace chess;
+
+int main(int argc, char** argv) {
+    const int depth = argc > 1 ? std::stoi(argv[1]) : 5;
+
+    TranspositionTable table(16);
+    AISettings settings{depth};
+    settings.useIterativeDeepening = true;
+    settings.printInfo = false;
+    Search search(Board(), settings, table);
+
+    std::vector<Board> boards;
+    for (const char* fen : positions) boards.emplace_back(fen);
+
+    // Setup: the first pass grows every buffer the search uses to its working size
+    for (const Board& board : boards) {
+        search.reset();
+        search.startSearch(board);
+    }
+    table.clear();
+
+    uint64_t nodes = 0;
+    counting = true;
+    for (const Board& board : boards) {
+        table.newSearch();
+        search.reset();
+        search.startSearch(board);
+        nodes += search.nodes();
+    }
+    counting = false;
+
+    std::printf("depth %d positions %zu nodes %llu allocations %llu %s\n", depth, boards.size(),
+                static_cast<unsigned long long>(nodes), static_cast<unsigned long long>(allocations.load()),
+                allocations == 0 ? "ok" : "FAILED");
+    return allocations == 0 ? 0 : 1;
+}
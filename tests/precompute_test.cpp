@@ -0,0 +1,73 @@
+// Checks the compile-time tables in precompute.hpp against chess::attacks: the king, knight and
+// pawn attack bitboards and the empty-board rook, bishop and queen moves for every square,
+// between and line for every pair of squares, and between against random blocker sets.
+//
+// Build from the repository root:
+//   g++ -std=c++17 -O2 tests/precompute_test.cpp -o wb-precompute-test
+//
+// Usage:
+//   wb-precompute-test
+//
+// Exits with 1 if any table entry differs.
+
+#include <cstdio>
+#include <random>
+#include "../chess.hpp"
+#include "../precompute.hpp"
+
+using namespace chess;
+
+int main() {
+    using Data = PrecomputedMoveData;
+    const Bitboard empty;
+
+    uint64_t mismatches = 0;
+    for (int square = 0; square < 64; square++) {
+        const Square sq(square);
+        mismatches += Data::kingAttackBitboards[square] != attacks::king(sq).getBits();
+        mismatches += Data::knightAttackBitboards[square] != attacks::knight(sq).getBits();
+        mismatches += Data::pawnAttackBitboards[square][0] != attacks::pawn(Color::WHITE, sq).getBits();
+        mismatches += Data::pawnAttackBitboards[square][1] != attacks::pawn(Color::BLACK, sq).getBits();
+        mismatches += Data::rookMoves[square] != attacks::rook(sq, empty).getBits();
+        mismatches += Data::bishopMoves[square] != attacks::bishop(sq, empty).getBits();
+        mismatches += Data::queenMoves[square] != attacks::queen(sq, empty).getBits();
+    }
+
+    // Two aligned squares see each other along the line with only the other one as a blocker,
+    // so between is where their attacks overlap and line is where their empty-board attacks do
+    for (int from = 0; from < 64; from++) {
+        for (int to = 0; to < 64; to++) {
+            const Square a(from);
+            const Square b(to);
+            uint64_t between = 0;
+            uint64_t line = 0;
+            if (from != to && (attacks::rook(a, empty) & Bitboard::fromSquare(b))) {
+                between = (attacks::rook(a, Bitboard::fromSquare(b)) & attacks::rook(b, Bitboard::fromSquare(a))).getBits();
+                line = (attacks::rook(a, empty) & attacks::rook(b, empty)).getBits() | 1ULL << from | 1ULL << to;
+            } else if (from != to && (attacks::bishop(a, empty) & Bitboard::fromSquare(b))) {
+                between = (attacks::bishop(a, Bitboard::fromSquare(b)) & attacks::bishop(b, Bitboard::fromSquare(a))).getBits();
+                line = (attacks::bishop(a, empty) & attacks::bishop(b, empty)).getBits() | 1ULL << from | 1ULL << to;
+            }
+            mismatches += Data::between[from][to] != between;
+            mismatches += Data::line[from][to] != line;
+        }
+    }
+
+    // A slider on one square reaches an aligned square exactly when nothing between them is occupied
+    std::mt19937_64 rng(12345);
+    for (int i = 0; i < 4096; i++) {
+        const Bitboard occupied(rng() & rng());
+        for (int from = 0; from < 64; from++) {
+            const Bitboard reached = attacks::queen(Square(from), occupied);
+            for (int to = 0; to < 64; to++) {
+                if (from == to || !(Data::queenMoves[from] >> to & 1)) continue;
+                const bool clear = (Data::between[from][to] & occupied.getBits()) == 0;
+                mismatches += clear != static_cast<bool>(reached & Bitboard::fromSquare(Square(to)));
+            }
+        }
+    }
+
+    std::printf("squares 64 mismatches %llu %s\n", static_cast<unsigned long long>(mismatches),
+                mismatches == 0 ? "ok" : "FAILED");
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,37 @@
+#!/usr/bin/env bash
+# Measures startup latency: the time from launching the engine to its "uciok" line, which it
+# prints as soon as the tables and options are ready. Each run starts a fresh process, so the
+# figure includes process creation and dynamic loading, as a GUI would see it.
+#
+# Usage, from the repository root after building the engine:
+#   tests/startup_time.sh <engine> [runs]
+#
+# Prints the minimum, median and maximum over the runs in milliseconds.
+
+set -euo pipefail
+
+engine=${1:?usage: $0 <engine> [runs]}
+runs=${2:-100}
+
+micros() {
+    local now=${EPOCHREALTIME/[.,]/}
+    echo "${now#0}"
+}
+
+times=()
+for ((run = 0; run < runs; run++)); do
+    start=$(micros)
+    coproc ENGINE { exec "$engine"; }
+    while IFS= read -r line <&"${ENGINE[0]}"; do
+        [[ $line == uciok ]] && break
+    done
+    end=$(micros)
+    pid=$ENGINE_PID
+    echo quit >&"${ENGINE[1]}"
+    wait "$pid" || true
+    times+=($((end - start)))
+done
+
+sorted=($(printf '%s\n' "${times[@]}" | sort -n))
+ms() { awk -v us="$1" 'BEGIN { printf "%.2f", us / 1000 }'; }
+echo "startup runs $runs ms min $(ms "${sorted[0]}") median $(ms "${sorted[runs / 2]}") max $(ms "${sorted[runs - 1]}")"
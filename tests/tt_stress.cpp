@@ -0,0 +1,83 @@
+// Stress test for the lockless transposition table. Several threads store and probe a handful
+// of shared buckets, where every key always stores the same score and move, so any hit that
+// returns another key's score or move is a torn entry the check word failed to catch.
+//
+// Build from the repository root:
+//   g++ -std=c++17 -O2 -pthread tests/tt_stress.cpp search.cpp transposition.cpp evaluation.cpp pawns.cpp nnue.cpp sliders.cpp -o wb-tt-stress
+//
+// Usage:
+//   wb-tt-stress [threads]
+//
+// Uses at least 4 threads, or every hardware thread if there are more. Exits with 1 on any
+// mismatch, or if no probe hit at all.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../search.hpp"
+#include "../transposition.hpp"
+
+using namespace chess;
+
+int main(int argc, char** argv) {
+    const int operations = 1000000;
+    const uint64_t hotBuckets = 16;
+    const uint64_t keysPerBucket = 8;
+    const int requested = argc > 1 ? std::stoi(argv[1]) : 1;
+    const int threads = std::max({requested, 4, static_cast<int>(std::thread::hardware_concurrency())});
+
+    // At 1 MB the bucket index is the low 14 bits of the key and the check word starts from the
+    // top 16, so key (bucket | j << 48) lands in `bucket` with its own check bits. More keys than
+    // slots per bucket keeps every thread overwriting the others' entries.
+    const size_t tableMb = 1;
+    const uint64_t bucketCount = tableMb * 1024 * 1024 / sizeof(TranspositionTable::Bucket);
+    static_assert(TranspositionTable::entriesPerBucket < 8, "keysPerBucket must exceed the slots per bucket");
+    TranspositionTable table(tableMb);
+
+    // Each key always stores the same score and move. They differ between keys of a bucket in a way
+    // that changes the data word's contribution to the check, so a slot holding one key's data and
+    // another key's check word must read as a miss rather than as a wrong score or move.
+    auto keyOf = [bucketCount](uint64_t bucket, uint64_t j) { return bucket % bucketCount | j << 48; };
+    auto scoreOf = [](uint64_t j) { return static_cast<int>(100 + j); };
+    auto moveOf = [](uint64_t j) { return Move(static_cast<uint16_t>(0x0A5C ^ (j << 8))); };
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> mismatches{0};
+    auto worker = [&](int thread) {
+        std::mt19937_64 rng(12345 + thread);
+        uint64_t localHits = 0;
+        uint64_t localMismatches = 0;
+        for (int i = 0; i < operations; i++) {
+            const uint64_t bucket = rng() % hotBuckets;
+            const uint64_t j = rng() % keysPerBucket;
+            const uint64_t key = keyOf(bucket, j);
+            if (rng() % 2) {
+                table.storeEvaluation(3, 0, scoreOf(j), TranspositionTable::exact, moveOf(j), key);
+                continue;
+            }
+            const int score = table.lookupEvaluation(0, 0, -Search::infinity, Search::infinity, key);
+            const Move move = table.getStoredMove(key);
+            if (score != TranspositionTable::lookupFailed) {
+                localHits++;
+                if (score != scoreOf(j)) localMismatches++;
+            }
+            if (move != Move::NO_MOVE && move != moveOf(j)) localMismatches++;
+        }
+        hits += localHits;
+        mismatches += localMismatches;
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++) workers.emplace_back(worker, i);
+    for (std::thread& thread : workers) thread.join();
+
+    const bool ok = mismatches == 0 && hits > 0;
+    std::printf("threads %d operations %llu hits %llu mismatches %llu %s\n", threads,
+                static_cast<unsigned long long>(threads) * operations, static_cast<unsigned long long>(hits.load()),
+                static_cast<unsigned long long>(mismatches.load()), ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -1,56 +1,373 @@
 #include "transposition.hpp"
 #include "search.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
-TranspositionTable::TranspositionTable(uint64_t size) : size_(size) {
-    entries.rehash(size);
+static constexpr char snapshotMagic[8] = {'W', 'B', 'H', 'A', 'S', 'H', '\0', '\0'};
+
+static_assert(sizeof(TranspositionTable::Bucket) == TranspositionTable::bucketBytes,
+              "bucket must fill exactly one cache line");
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) && sizeof(std::atomic<uint16_t>) == sizeof(uint16_t),
+              "atomics must not add storage to the packed entries");
+
+uint64_t TranspositionTable::Entry::pack() const {
+    return static_cast<uint64_t>(move.move())
+         | static_cast<uint64_t>(static_cast<uint16_t>(value)) << 16
+         | static_cast<uint64_t>(static_cast<uint16_t>(staticEval)) << 32
+         | static_cast<uint64_t>(static_cast<uint8_t>(depth + 1)) << 48
+         | static_cast<uint64_t>(nodeType) << (56 + generationBits)
+         | static_cast<uint64_t>(generation & generationMask) << 56;
+}
+
+TranspositionTable::Entry TranspositionTable::Entry::unpack(uint64_t data) {
+    return Entry(
+        static_cast<int16_t>(data >> 16),
+        static_cast<int16_t>(data >> 32),
+        static_cast<uint8_t>((data >> 48) - 1),
+        static_cast<uint8_t>(data >> (56 + generationBits)),
+        static_cast<uint8_t>((data >> 56) & generationMask),
+        Move(static_cast<uint16_t>(data))
+    );
+}
+
+TranspositionTable::TranspositionTable(size_t sizeMb) : size_(0) {
+    resize(sizeMb);
+}
+
+TranspositionTable::~TranspositionTable() {
+    release();
+}
+
+// Tries explicit huge pages first, then transparent huge pages, then a plain aligned allocation
+void TranspositionTable::allocate(uint64_t count) {
+    size_t bytes = count * sizeof(Bucket);
+    void* memory = nullptr;
+
+#if defined(__linux__)
+    constexpr size_t hugePageBytes = 2 * 1024 * 1024;
+    size_t hugeBytes = (bytes + hugePageBytes - 1) / hugePageBytes * hugePageBytes;
+
+    memory = mmap(nullptr, hugeBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (memory != MAP_FAILED) {
+        mapped_ = true;
+        hugePages_ = true;
+        allocatedBytes_ = hugeBytes;
+    } else {
+        memory = std::aligned_alloc(hugePageBytes, hugeBytes);
+        if (memory) {
+            hugePages_ = madvise(memory, hugeBytes, MADV_HUGEPAGE) == 0;
+            allocatedBytes_ = hugeBytes;
+        }
+    }
+#endif
+
+    if (!memory) {
+        memory = std::aligned_alloc(bucketBytes, bytes);
+        allocatedBytes_ = bytes;
+    }
+    if (!memory) throw std::bad_alloc();
+
+    buckets = static_cast<Bucket*>(memory);
+    size_ = count;
+}
+
+void TranspositionTable::release() {
+    if (!buckets) return;
+#if defined(__linux__) || defined(__APPLE__)
+    if (mapped_) {
+        munmap(buckets, allocatedBytes_);
+    } else {
+        std::free(buckets);
+    }
+#else
+    std::free(buckets);
+#endif
+    buckets = nullptr;
+    size_ = 0;
+    allocatedBytes_ = 0;
+    mapped_ = false;
+    hugePages_ = false;
+}
+
+void TranspositionTable::resize(size_t sizeMb, int threads) {
+    uint64_t count = std::max<uint64_t>(1, sizeMb * 1024 * 1024 / sizeof(Bucket));
+    if (count != size_) {
+        // Release the old table before allocating the new one so peak usage stays at one table
+        release();
+        allocate(count);
+    }
+    clear(threads);
+}
+
+// Zeroing also faults the pages in, so splitting it up parallelises the first touch as well
+void TranspositionTable::clear(int threads) {
+    threads = std::max(1, threads);
+    uint64_t chunk = (size_ + threads - 1) / threads;
+
+    auto zero = [this, chunk](int thread) {
+        uint64_t start = std::min(size_, chunk * thread);
+        uint64_t end = std::min(size_, start + chunk);
+        std::memset(static_cast<void*>(buckets + start), 0, (end - start) * sizeof(Bucket));
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; i++) {
+        workers.emplace_back(zero, i);
+    }
+    zero(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    for (ThreadStats& counters : threadStats_) {
+        for (auto* counter : {&counters.probes, &counters.hits, &counters.cutoffs,
+                              &counters.stores, &counters.overwrites, &counters.collisions}) {
+            counter->store(0, std::memory_order_relaxed);
+        }
+    }
 }
 
-void TranspositionTable::clear() {
-    std::lock_guard<std::mutex> lock(tableMutex);
-    entries.clear();
+// Each thread gets its own cache line of counters; slots are only shared if more than
+// maxStatsThreads threads have ever probed, in which case counts become approximate
+TranspositionTable::ThreadStats& TranspositionTable::localStats() const {
+    static std::atomic<int> nextSlot{0};
+    thread_local int slot = nextSlot.fetch_add(1, std::memory_order_relaxed) % maxStatsThreads;
+    return threadStats_[slot];
 }
 
-uint64_t TranspositionTable::index(uint64_t hash) const {
-    return hash % size_;
+TranspositionTable::Stats TranspositionTable::stats() const {
+    Stats total;
+    for (const ThreadStats& counters : threadStats_) {
+        total.probes += counters.probes.load(std::memory_order_relaxed);
+        total.hits += counters.hits.load(std::memory_order_relaxed);
+        total.cutoffs += counters.cutoffs.load(std::memory_order_relaxed);
+        total.stores += counters.stores.load(std::memory_order_relaxed);
+        total.overwrites += counters.overwrites.load(std::memory_order_relaxed);
+        total.collisions += counters.collisions.load(std::memory_order_relaxed);
+    }
+    return total;
 }
 
-Move TranspositionTable::getStoredMove(uint64_t hash) {
-    std::lock_guard<std::mutex> lock(tableMutex);
-    auto it = entries.find(hash);
-    return (it != entries.end()) ? it->second.move : Move::NO_MOVE;
+int TranspositionTable::hashfull() const {
+    uint64_t sampleBuckets = std::min<uint64_t>(size_, 1000);
+    int used = 0;
+    for (uint64_t i = 0; i < sampleBuckets; i++) {
+        for (int j = 0; j < entriesPerBucket; j++) {
+            uint64_t data = buckets[i].data[j].load(std::memory_order_relaxed);
+            if (data != 0 && Entry::unpack(data).generation == generation_) used++;
+        }
+    }
+    return static_cast<int>(used * 1000 / (sampleBuckets * entriesPerBucket));
 }
 
-int TranspositionTable::lookupEvaluation(int depth, int plyFromRoot, int alpha, int beta, uint64_t hash) {
+bool TranspositionTable::save(const std::string& path) const {
+    static_assert(sizeof(SnapshotHeader) <= snapshotHeaderBytes, "snapshot header must fit in its page");
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+    header.version = snapshotVersion;
+    header.bucketBytes = bucketBytes;
+    header.entriesPerBucket = entriesPerBucket;
+    header.entryBytes = entryBytes;
+    header.bucketCount = size_;
+    header.generation = generation_;
+
+    char page[snapshotHeaderBytes] = {};
+    std::memcpy(page, &header, sizeof(header));
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(page, sizeof(page), 1, file) == 1
+           && std::fwrite(static_cast<const void*>(buckets), sizeof(Bucket), size_, file) == size_;
+    return std::fclose(file) == 0 && ok;
+}
+
+bool TranspositionTable::load(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    SnapshotHeader header{};
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1
+           && std::memcmp(header.magic, snapshotMagic, sizeof(header.magic)) == 0
+           && header.version == snapshotVersion
+           && header.bucketBytes == bucketBytes
+           && header.entriesPerBucket == entriesPerBucket
+           && header.entryBytes == entryBytes
+           && header.bucketCount > 0;
+
+    long fileBytes = -1;
+    if (ok) {
+        ok = std::fseek(file, 0, SEEK_END) == 0
+          && (fileBytes = std::ftell(file)) >= static_cast<long>(snapshotHeaderBytes);
+    }
+    if (ok) {
+        // A truncated or padded file means the header can't be trusted either. The count is checked
+        // by division: a corrupted count can make count * sizeof(Bucket) wrap round to the file size
+        uint64_t dataBytes = static_cast<uint64_t>(fileBytes) - snapshotHeaderBytes;
+        ok = dataBytes % sizeof(Bucket) == 0
+          && header.bucketCount == dataBytes / sizeof(Bucket)
+          && header.bucketCount <= maxSizeMb * 1024 * 1024 / sizeof(Bucket);
+    }
+    size_t bytes = ok ? header.bucketCount * sizeof(Bucket) : 0;
+    if (!ok) {
+        std::fclose(file);
+        return false;
+    }
+
+#if defined(__linux__) || defined(__APPLE__)
+    // Map the bucket array privately: pages fault in on first probe and writes never reach the file.
+    // The offset must be page aligned, which the 4 KB header is not on 16 KB-page systems such as
+    // Apple Silicon; those read the file instead
+    if (snapshotHeaderBytes % static_cast<size_t>(sysconf(_SC_PAGESIZE)) == 0) {
+        void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(file), snapshotHeaderBytes);
+        if (memory != MAP_FAILED) {
+            std::fclose(file);
+            release();
+            buckets = static_cast<Bucket*>(memory);
+            size_ = header.bucketCount;
+            allocatedBytes_ = bytes;
+            mapped_ = true;
+            generation_ = header.generation;
+            return true;
+        }
+    }
+#endif
+
+    release();
+    allocate(header.bucketCount);
+    ok = std::fseek(file, snapshotHeaderBytes, SEEK_SET) == 0
+      && std::fread(static_cast<void*>(buckets), sizeof(Bucket), size_, file) == size_;
+    std::fclose(file);
+    if (!ok) {
+        clear();
+        return false;
+    }
+
+    generation_ = header.generation;
+    return true;
+}
+
+void TranspositionTable::newSearch() {
+    generation_ = (generation_ + 1) & generationMask;
+}
+
+uint16_t TranspositionTable::checkWord(uint64_t hash, uint64_t data) {
+    return static_cast<uint16_t>((hash >> 48) ^ data ^ (data >> 16) ^ (data >> 32) ^ (data >> 48));
+}
+
+// An all-zero data word is an empty slot, since stored depths are offset by one
+bool TranspositionTable::probe(uint64_t hash, Entry& entry) const {
+    const Bucket& bucket = buckets[index(hash)];
+    for (int i = 0; i < entriesPerBucket; i++) {
+        uint64_t data = bucket.data[i].load(std::memory_order_relaxed);
+        if (data != 0 && bucket.check[i].load(std::memory_order_relaxed) == checkWord(hash, data)) {
+            entry = Entry::unpack(data);
+            return true;
+        }
+    }
+    return false;
+}
+
+Move TranspositionTable::getStoredMove(uint64_t hash) const {
+    Entry entry;
+    return probe(hash, entry) ? entry.move : Move(Move::NO_MOVE);
+}
+
+int TranspositionTable::getStoredStaticEval(uint64_t hash) const {
+    Entry entry;
+    return probe(hash, entry) ? entry.staticEval : noStaticEval;
+}
+
+int TranspositionTable::lookupEvaluation(int depth, int plyFromRoot, int alpha, int beta, uint64_t hash) const {
     if (!enabled) return lookupFailed;
 
-    std::lock_guard<std::mutex> lock(tableMutex);
-    auto it = entries.find(hash);
-    
-    if (it != entries.end() && it->second.key == hash) {
-        const Entry& entry = it->second;
-        if (entry.depth >= depth) {
-            int correctedScore = correctRetrievedMateScore(entry.value, plyFromRoot);
-            
-            if (entry.nodeType == exact) return correctedScore;
-            if (entry.nodeType == upperBound && correctedScore <= alpha) return correctedScore;
-            if (entry.nodeType == lowerBound && correctedScore >= beta) return correctedScore;
+    ThreadStats& counters = localStats();
+    increment(counters.probes);
+
+    Entry entry;
+    if (!probe(hash, entry)) return lookupFailed;
+    increment(counters.hits);
+
+    if (entry.depth >= depth) {
+        int correctedScore = correctRetrievedMateScore(entry.value, plyFromRoot);
+
+        if (entry.nodeType == exact
+            || (entry.nodeType == upperBound && correctedScore <= alpha)
+            || (entry.nodeType == lowerBound && correctedScore >= beta)) {
+            increment(counters.cutoffs);
+            return correctedScore;
         }
     }
     return lookupFailed;
 }
 
-void TranspositionTable::storeEvaluation(int depth, int numPlySearched, int eval, 
-                                       int evalType, Move move, uint64_t hash) {
+// Higher scores are worth keeping: deep, exact and recent entries
+int TranspositionTable::replacementScore(const Entry& entry) const {
+    int age = (generation_ - entry.generation) & generationMask;
+    return entry.depth + (entry.nodeType == exact ? 2 : 0) - 8 * age;
+}
+
+void TranspositionTable::storeEvaluation(int depth, int numPlySearched, int eval,
+                                       int evalType, Move move, uint64_t hash, int staticEval) {
     if (!enabled) return;
 
-    std::lock_guard<std::mutex> lock(tableMutex);
-    entries[hash] = Entry(
-        hash,
-        correctMateScoreForStorage(eval, numPlySearched),
-        static_cast<uint8_t>(depth),
+    ThreadStats& counters = localStats();
+    Bucket& bucket = buckets[index(hash)];
+
+    // Reuse the slot already holding this position, otherwise evict the least valuable entry
+    int replace = 0;
+    int replaceScore = std::numeric_limits<int>::max();
+    bool evicting = true;
+    for (int i = 0; i < entriesPerBucket; i++) {
+        uint64_t data = bucket.data[i].load(std::memory_order_relaxed);
+        if (data == 0) {
+            replace = i;
+            evicting = false;
+            break;
+        }
+        Entry existing = Entry::unpack(data);
+        if (bucket.check[i].load(std::memory_order_relaxed) == checkWord(hash, data)) {
+            // Don't let a shallow bound from this search clobber a deeper result for the same position
+            if (evalType != exact && existing.generation == generation_ && depth + 2 < existing.depth) {
+                return;
+            }
+            if (move == Move::NO_MOVE) move = existing.move;
+            if (staticEval == noStaticEval) staticEval = existing.staticEval;
+            replace = i;
+            evicting = false;
+            break;
+        }
+        int score = replacementScore(existing);
+        if (score < replaceScore) {
+            replace = i;
+            replaceScore = score;
+        }
+    }
+
+    increment(counters.stores);
+    if (evicting) increment(counters.overwrites);
+
+    int value = correctMateScoreForStorage(eval, numPlySearched);
+    uint64_t data = Entry(
+        std::clamp(value, INT16_MIN + 1, INT16_MAX),
+        staticEval,
+        static_cast<uint8_t>(std::clamp(depth, 0, 254)),
         static_cast<uint8_t>(evalType),
+        generation_,
         move
-    );
+    ).pack();
+    bucket.data[replace].store(data, std::memory_order_relaxed);
+    bucket.check[replace].store(checkWord(hash, data), std::memory_order_relaxed);
 }
 
 int TranspositionTable::correctMateScoreForStorage(int score, int numPlySearched) {
@@ -2,25 +2,46 @@
 #define TRANSPOSITION_HPP
 
 #include "chess.hpp"
-#include <vector>
-#include <mutex>
-#include <unordered_map>
+#include <atomic>
+#include <string>
 
 using namespace chess;
 
 class TranspositionTable {
 public:
     struct Entry {
-        uint64_t key;       // Changed from size_t to match chess-library's hash type
         int value;
+        // Reserved: the search neither stores nor reads it yet, so it is always noStaticEval.
+        // It is meant for pruning that needs a node's static eval at full-width nodes; the
+        // quiescence stand pat already gets repeated evaluations from the evaluation cache
+        int staticEval;
         uint8_t depth;
         uint8_t nodeType;
+        uint8_t generation; // Search generation that wrote the entry, see newSearch()
         Move move;
 
-        Entry() : key(0), value(0), depth(0), nodeType(exact), move(Move::NO_MOVE) {}
+        Entry() : value(0), staticEval(noStaticEval), depth(0), nodeType(exact), generation(0), move(Move::NO_MOVE) {}
 
-        Entry(uint64_t key, int value, uint8_t depth, uint8_t nodeType, Move move)
-            : key(key), value(value), depth(depth), nodeType(nodeType), move(move) {}
+        Entry(int value, int staticEval, uint8_t depth, uint8_t nodeType, uint8_t generation, Move move)
+            : value(value), staticEval(staticEval), depth(depth), nodeType(nodeType), generation(generation), move(move) {}
+
+        // Packs everything but the key into the 64-bit data word of a slot:
+        // move (16) | value (16) | static eval (16) | depth + 1 (8) | node type (2) + generation (6)
+        uint64_t pack() const;
+        static Entry unpack(uint64_t data);
+    };
+
+    // Entries are split across the bucket: 6 data words followed by 6 16-bit check words,
+    // so each entry costs 10 bytes. The check word is the top 16 bits of the key XOR-ed with
+    // a fold of the data word, which also catches data and check written by different threads.
+    static constexpr size_t bucketBytes = 64;
+    static constexpr int entriesPerBucket = 6;
+    static constexpr size_t entryBytes = sizeof(uint64_t) + sizeof(uint16_t);
+
+    struct alignas(bucketBytes) Bucket {
+        std::atomic<uint64_t> data[entriesPerBucket];
+        std::atomic<uint16_t> check[entriesPerBucket];
+        uint8_t padding[bucketBytes - entriesPerBucket * entryBytes];
     };
 
     static const int lookupFailed = -1;
@@ -28,21 +49,112 @@ public:
     static const int lowerBound = 1;
     static const int upperBound = 2;
 
-    TranspositionTable(uint64_t size);
-    void clear();
-    Move getStoredMove(uint64_t hash);
-    int lookupEvaluation(int depth, int plyFromRoot, int alpha, int beta, uint64_t hash);
-    void storeEvaluation(int depth, int numPlySearched, int eval, int evalType, Move move, uint64_t hash);
+    // Scores are stored as 16-bit values
+    static constexpr int noStaticEval = INT16_MIN;
+
+    // Generations wrap around; they share a byte with the node type in the packed entry
+    static constexpr int generationBits = 6;
+    static constexpr uint8_t generationMask = (1 << generationBits) - 1;
+
+    struct Stats {
+        uint64_t probes = 0;     // lookupEvaluation calls
+        uint64_t hits = 0;       // Probes that found the position
+        uint64_t cutoffs = 0;    // Hits deep and tight enough to return a score
+        uint64_t stores = 0;
+        uint64_t overwrites = 0; // Stores that evicted a different position
+        uint64_t collisions = 0; // Stored moves the search found illegal, see reportCollision()
+    };
+
+    TranspositionTable(size_t sizeMb);
+    ~TranspositionTable();
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    // resize() and clear() must not run while a search is using the table.
+    // Zeroing is split across the given number of threads.
+    void resize(size_t sizeMb, int threads = 1);
+    void clear(int threads = 1);
+    void newSearch();
+    bool usesHugePages() const { return hugePages_; }
+    size_t sizeMb() const { return size_ * sizeof(Bucket) / (1024 * 1024); }
+    static constexpr size_t maxSizeMb = 1024; // Largest Hash option, also the cap on loaded snapshots
+
+    // Snapshots write the bucket array verbatim after a page-sized header, so loading
+    // maps the file straight into the table. Both return false on I/O or layout mismatch.
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    // Starts loading the bucket for a position into cache; call right after makeMove so the
+    // memory access overlaps move generation and evaluation of the child
+    void prefetch(uint64_t hash) const {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(&buckets[index(hash)]);
+#endif
+    }
+
+    Move getStoredMove(uint64_t hash) const;
+    int getStoredStaticEval(uint64_t hash) const; // Always noStaticEval for now, see Entry::staticEval
+    int lookupEvaluation(int depth, int plyFromRoot, int alpha, int beta, uint64_t hash) const;
+    void storeEvaluation(int depth, int numPlySearched, int eval, int evalType, Move move, uint64_t hash,
+                         int staticEval = noStaticEval);
+
+    // Called by the search when a stored move is not legal in the probed position,
+    // which means the entry belonged to a different position with the same key bits
+    void reportCollision() { increment(localStats().collisions); }
+
+    // Sums the per-thread counters; cleared together with the table
+    Stats stats() const;
+    // Permille of sampled entries written by the current search, for UCI "info hashfull"
+    int hashfull() const;
 
 private:
-    std::unordered_map<uint64_t, Entry> entries;
-    std::mutex tableMutex;
-    const uint64_t size_;
+    Bucket* buckets = nullptr;         // Allocated once per resize, never grows during search
+    uint64_t size_;                    // Number of buckets
+    size_t allocatedBytes_ = 0;
+    bool mapped_ = false;              // Backing store came from mmap rather than the heap
+    bool hugePages_ = false;           // Backing store is (or was advised to be) huge pages
+    uint8_t generation_ = 0;           // Bumped once per search so stale entries are evicted first
     bool enabled = true;
 
-    uint64_t index(uint64_t hash) const;
-    int correctMateScoreForStorage(int score, int numPlySearched);
-    int correctRetrievedMateScore(int score, int numPlySearched);
+    // Bump whenever the packed entry or bucket layout changes so old snapshots are rejected
+    static constexpr uint32_t snapshotVersion = 1;
+    static constexpr size_t snapshotHeaderBytes = 4096;
+
+    struct SnapshotHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t bucketBytes;
+        uint32_t entriesPerBucket;
+        uint32_t entryBytes;
+        uint64_t bucketCount;
+        uint8_t generation;
+    };
+
+    // Counters are only written by their owning thread, so relaxed load/store is enough
+    struct alignas(64) ThreadStats {
+        std::atomic<uint64_t> probes{0};
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> cutoffs{0};
+        std::atomic<uint64_t> stores{0};
+        std::atomic<uint64_t> overwrites{0};
+        std::atomic<uint64_t> collisions{0};
+    };
+    static constexpr int maxStatsThreads = 64;
+    mutable ThreadStats threadStats_[maxStatsThreads];
+
+    ThreadStats& localStats() const;
+    static void increment(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    uint64_t index(uint64_t hash) const { return hash % size_; }
+    void allocate(uint64_t count);
+    void release();
+    static uint16_t checkWord(uint64_t hash, uint64_t data);
+    int replacementScore(const Entry& entry) const;
+    bool probe(uint64_t hash, Entry& entry) const;
+    static int correctMateScoreForStorage(int score, int numPlySearched);
+    static int correctRetrievedMateScore(int score, int numPlySearched);
 };
 
 #endif // TRANSPOSITION_HPP
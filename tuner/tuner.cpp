@@ -0,0 +1,374 @@
+// Texel-style tuner for the handcrafted evaluation weights: piece values, the piece-square
+// tables in tables.hpp and the mop-up multipliers. Reads labelled positions, fits the
+// sigmoid scaling constant, then runs full-batch Adam on the mean squared error between
+// the game results and the sigmoid of the evaluation, with the gradient split across threads.
+// Writes the tuned values, tables and weights as a drop-in replacement for tables.hpp.
+//
+// Build from the repository root:
+//   g++ -std=c++17 -O2 -pthread tuner/tuner.cpp evaluation.cpp pawns.cpp nnue.cpp sliders.cpp -o wb-tuner
+//
+// Usage:
+//   wb-tuner <dataset> [--epochs N] [--lr RATE] [--threads N] [--out FILE]
+//
+// Each dataset line is a FEN followed by the game result from white's point of view, either
+// as 1-0 / 0-1 / 1/2-1/2 (optionally quoted) or as 1.0 / 0.5 / 0.0 (optionally in brackets).
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../chess.hpp"
+#include "../evaluation.hpp"
+#include "../pawns.hpp"
+#include "../precompute.hpp"
+#include "../tables.hpp"
+
+using namespace chess;
+
+namespace {
+
+// 24-byte chess.hpp encoding plus what the tuner needs that does not depend on tuned weights
+struct Sample {
+    PackedBoard board;
+    int16_t fixedEval;    // Untuned terms (mobility, king safety, pawn structure), white's view
+    uint8_t phase;        // Game phase, capped at Evaluation::totalPhase
+    uint8_t result;       // Half points for white: 0, 1 or 2
+};
+
+class Tuner {
+public:
+    // Parameter layout: piece values, then the seven tables, then the mop-up weights
+    static constexpr int valueOffset = 0;
+    static constexpr int tableOffset = 5;
+    static constexpr int tableCount = 7;
+    static constexpr int mopUpOffset = tableOffset + tableCount * 64;
+    static constexpr int parameterCount = mopUpOffset + 2;
+
+    // Order of the tables, matching the piece types with the king's two tables last
+    static constexpr const char* tableNames[tableCount] = {
+        "pawns", "knights", "bishops", "rooks", "queens", "kingMiddle", "kingEnd"
+    };
+
+    Tuner(int threads) : threads(threads), parameters(parameterCount) {
+        const int values[5] = { Evaluation::pawnValue, Evaluation::knightValue, Evaluation::bishopValue,
+                                Evaluation::rookValue, Evaluation::queenValue };
+        const int* tables[tableCount] = { PieceSquareTable::pawns, PieceSquareTable::knights,
+                                          PieceSquareTable::bishops, PieceSquareTable::rooks,
+                                          PieceSquareTable::queens, PieceSquareTable::kingMiddle,
+                                          PieceSquareTable::kingEnd };
+        for (int i = 0; i < 5; i++) parameters[valueOffset + i] = values[i];
+        for (int table = 0; table < tableCount; table++) {
+            for (int square = 0; square < 64; square++) {
+                parameters[tableOffset + table * 64 + square] = tables[table][square];
+            }
+        }
+        parameters[mopUpOffset] = Evaluation::mopUpCentreWeight;
+        parameters[mopUpOffset + 1] = Evaluation::mopUpDistanceWeight;
+    }
+
+    bool load(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) return false;
+
+        std::string line;
+        size_t skipped = 0;
+        while (std::getline(file, line)) {
+            std::string fen;
+            int result;
+            if (!parseLine(line, fen, result)) {
+                skipped++;
+                continue;
+            }
+
+            Board board(fen);
+            Sample sample;
+            sample.board = Board::Compact::encode(board);
+            sample.phase = static_cast<uint8_t>(std::min(Evaluation::countPhase(board), Evaluation::totalPhase));
+            sample.result = static_cast<uint8_t>(result);
+            sample.fixedEval = static_cast<int16_t>(
+                Evaluation::taper(Evaluation::evaluatePieceActivity(board), sample.phase)
+                + PawnHashTable::evaluatePawns(board).score);
+            samples.push_back(sample);
+
+            if (samples.size() % 1000000 == 0) {
+                std::cout << "loaded " << samples.size() << " positions" << std::endl;
+            }
+        }
+
+        std::cout << "loaded " << samples.size() << " positions (" << samples.size() * sizeof(Sample) / (1024 * 1024)
+                  << " MB), skipped " << skipped << " lines" << std::endl;
+        return !samples.empty();
+    }
+
+    // Finds the sigmoid scale that best fits the results with the current weights
+    void fitScale() {
+        double low = 0.0, high = 3.0;
+        for (int i = 0; i < 40; i++) {
+            double a = low + (high - low) / 3;
+            double b = high - (high - low) / 3;
+            if (loss(a) < loss(b)) high = b; else low = a;
+        }
+        scale = (low + high) / 2;
+        std::cout << "scale " << scale << " loss " << loss(scale) << std::endl;
+    }
+
+    void run(int epochs, double learningRate) {
+        // Adam with the usual decay rates
+        const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+        std::vector<double> m(parameterCount), v(parameterCount);
+
+        for (int epoch = 1; epoch <= epochs; epoch++) {
+            std::vector<double> gradient = computeGradient();
+            for (int i = 0; i < parameterCount; i++) {
+                m[i] = beta1 * m[i] + (1 - beta1) * gradient[i];
+                v[i] = beta2 * v[i] + (1 - beta2) * gradient[i] * gradient[i];
+                double mHat = m[i] / (1 - std::pow(beta1, epoch));
+                double vHat = v[i] / (1 - std::pow(beta2, epoch));
+                parameters[i] -= learningRate * mHat / (std::sqrt(vHat) + epsilon);
+            }
+
+            if (epoch % 10 == 0 || epoch == epochs) {
+                std::cout << "epoch " << epoch << " loss " << std::setprecision(8) << loss(scale) << std::endl;
+            }
+        }
+    }
+
+    bool write(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) return false;
+
+        auto rounded = [&](int index) { return static_cast<int>(std::lround(parameters[index])); };
+
+        out << "// Generated by tuner/tuner.cpp from " << samples.size() << " positions, loss "
+            << std::setprecision(8) << loss(scale) << " at scale " << scale << "\n"
+            << "#ifndef PIECE_SQUARE_TABLE_HPP\n"
+            << "#define PIECE_SQUARE_TABLE_HPP\n\n"
+            << "#include \"chess.hpp\"\n\n"
+            << "namespace chess {\n\n"
+            << "class PieceSquareTable {\n"
+            << "public:\n"
+            << "    // Piece values and mop-up weights are tuned together with the tables, so they live here too\n";
+
+        const char* valueNames[5] = { "pawnValue", "knightValue", "bishopValue", "rookValue", "queenValue" };
+        for (int i = 0; i < 5; i++) {
+            out << "    static constexpr int " << valueNames[i] << " = " << rounded(valueOffset + i) << ";\n";
+        }
+        out << "    static constexpr int mopUpCentreWeight = " << rounded(mopUpOffset) << ";\n"
+            << "    static constexpr int mopUpDistanceWeight = " << rounded(mopUpOffset + 1) << ";\n";
+
+        for (int table = 0; table < tableCount; table++) {
+            out << "\n    static constexpr int " << tableNames[table] << "[] = {\n";
+            for (int rank = 0; rank < 8; rank++) {
+                out << "        ";
+                for (int file = 0; file < 8; file++) {
+                    out << std::setw(3) << rounded(tableOffset + table * 64 + rank * 8 + file);
+                    if (rank < 7 || file < 7) out << ",";
+                }
+                out << "\n";
+            }
+            out << "    };\n";
+        }
+
+        out << "};\n\n"
+            << "} // namespace chess\n\n"
+            << "#endif // PIECE_SQUARE_TABLE_HPP\n";
+        return static_cast<bool>(out);
+    }
+
+private:
+    int threads;
+    double scale = 1.0;
+    std::vector<double> parameters;
+    std::vector<Sample> samples;
+
+    static bool parseLine(const std::string& line, std::string& fen, int& result) {
+        // The FEN is everything before the last token
+        size_t end = line.find_last_not_of(" \t\r;");
+        if (end == std::string::npos) return false;
+        size_t start = line.find_last_of(" \t", end);
+        if (start == std::string::npos) return false;
+
+        std::string label = line.substr(start + 1, end - start);
+        label.erase(std::remove_if(label.begin(), label.end(),
+                                   [](char c) { return c == '"' || c == '[' || c == ']'; }), label.end());
+        if (label == "1-0" || label == "1.0" || label == "1") result = 2;
+        else if (label == "0-1" || label == "0.0" || label == "0") result = 0;
+        else if (label == "1/2-1/2" || label == "0.5") result = 1;
+        else return false;
+
+        fen = line.substr(0, start);
+        // Drop EPD-style opcodes such as "c9" that some datasets put before the label
+        std::istringstream fields(fen);
+        std::string field;
+        fen.clear();
+        for (int i = 0; i < 6 && fields >> field; i++) {
+            if (i >= 4 && !std::all_of(field.begin(), field.end(), ::isdigit)) break;
+            fen += (fen.empty() ? "" : " ") + field;
+        }
+        return !fen.empty();
+    }
+
+    // Calls visit(parameter, coefficient) for every tuned term of the white-relative evaluation,
+    // which is linear in the parameters apart from the fixed untuned part
+    template <typename Visit>
+    static void forEachTerm(const Sample& sample, const std::vector<double>& parameters, Visit&& visit) {
+        const double middlegame = static_cast<double>(sample.phase) / Evaluation::totalPhase;
+        const double endgame = 1.0 - middlegame;
+
+        uint64_t occupied = 0;
+        for (int i = 0; i < 8; i++) occupied |= static_cast<uint64_t>(sample.board[i]) << (56 - i * 8);
+
+        int kings[2] = {0, 0};
+        double material[2] = {0, 0};
+        int offset = 16;
+        while (occupied) {
+            const int square = __builtin_ctzll(occupied);
+            occupied &= occupied - 1;
+            int nibble = sample.board[offset / 2] >> (offset % 2 == 0 ? 4 : 0) & 0xF;
+            offset++;
+
+            // Decode the special nibbles of the packed format back into plain pieces
+            if (nibble == 12) nibble = square / 8 == 3 ? 0 : 6; // Pawn that can be taken en passant
+            else if (nibble == 13) nibble = 3;                  // White rook with castling rights
+            else if (nibble == 14) nibble = 9;                  // Black rook with castling rights
+            else if (nibble == 15) nibble = 11;                 // Black king, black to move
+
+            const int color = nibble / 6;
+            const int type = nibble % 6;
+            const double sign = color == 0 ? 1.0 : -1.0;
+            // Tables are laid out with rank 8 first, so white reads them flipped
+            const int index = color == 0 ? square ^ 56 : square;
+
+            if (type == 5) {
+                kings[color] = square;
+                visit(tableOffset + 5 * 64 + index, sign * middlegame);
+                visit(tableOffset + 6 * 64 + index, sign * endgame);
+            } else {
+                visit(valueOffset + type, sign);
+                visit(tableOffset + type * 64 + index, sign);
+                material[color] += parameters[valueOffset + type];
+            }
+        }
+
+        // Mop-up only applies to the endgame half; the material gate uses the current values
+        for (int color = 0; color < 2; color++) {
+            const int them = color ^ 1;
+            if (material[color] > material[them] + parameters[valueOffset] * 2) {
+                const double sign = color == 0 ? 1.0 : -1.0;
+                visit(mopUpOffset, sign * endgame * PrecomputedMoveData::centreManhattanDistance[kings[them]]);
+                visit(mopUpOffset + 1, sign * endgame
+                      * (14 - PrecomputedMoveData::numRookMovesToReachSquare(kings[color], kings[them])));
+            }
+        }
+    }
+
+    double evaluate(const Sample& sample) const {
+        double eval = sample.fixedEval;
+        forEachTerm(sample, parameters, [&](int index, double coefficient) { eval += parameters[index] * coefficient; });
+        return eval;
+    }
+
+    static double sigmoid(double eval, double k) {
+        return 1.0 / (1.0 + std::pow(10.0, -k * eval / 400.0));
+    }
+
+    // Runs work(begin, end, thread) over equal slices of the samples on every thread
+    template <typename Work>
+    void parallel(Work&& work) const {
+        std::vector<std::thread> workers;
+        const size_t slice = (samples.size() + threads - 1) / threads;
+        for (int thread = 0; thread < threads; thread++) {
+            size_t begin = std::min(samples.size(), thread * slice);
+            size_t end = std::min(samples.size(), begin + slice);
+            workers.emplace_back([&, begin, end, thread]() { work(begin, end, thread); });
+        }
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    double loss(double k) const {
+        std::vector<double> partial(threads);
+        parallel([&](size_t begin, size_t end, int thread) {
+            double sum = 0;
+            for (size_t i = begin; i < end; i++) {
+                double error = samples[i].result / 2.0 - sigmoid(evaluate(samples[i]), k);
+                sum += error * error;
+            }
+            partial[thread] = sum;
+        });
+
+        double total = 0;
+        for (double sum : partial) total += sum;
+        return total / samples.size();
+    }
+
+    std::vector<double> computeGradient() const {
+        std::vector<std::vector<double>> partial(threads, std::vector<double>(parameterCount));
+        parallel([&](size_t begin, size_t end, int thread) {
+            std::vector<double>& gradient = partial[thread];
+            for (size_t i = begin; i < end; i++) {
+                const Sample& sample = samples[i];
+                double s = sigmoid(evaluate(sample), scale);
+                // d/dE of (r - s)^2, averaged over the samples below
+                double common = -2.0 * (sample.result / 2.0 - s) * s * (1 - s) * scale * std::log(10.0) / 400.0;
+                forEachTerm(sample, parameters, [&](int index, double coefficient) {
+                    gradient[index] += common * coefficient;
+                });
+            }
+        });
+
+        std::vector<double> gradient(parameterCount);
+        for (const std::vector<double>& threadGradient : partial) {
+            for (int i = 0; i < parameterCount; i++) gradient[i] += threadGradient[i] / samples.size();
+        }
+        return gradient;
+    }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <dataset> [--epochs N] [--lr RATE] [--threads N] [--out FILE]" << std::endl;
+        return 1;
+    }
+
+    std::string dataset = argv[1];
+    std::string out = "tables_tuned.hpp";
+    int epochs = 500;
+    double learningRate = 1.0;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--epochs") epochs = std::stoi(argv[i + 1]);
+        else if (option == "--lr") learningRate = std::stod(argv[i + 1]);
+        else if (option == "--threads") threads = std::max(1, std::stoi(argv[i + 1]));
+        else if (option == "--out") out = argv[i + 1];
+    }
+
+    Tuner tuner(threads);
+    if (!tuner.load(dataset)) {
+        std::cerr << "no positions loaded from " << dataset << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    tuner.fitScale();
+    tuner.run(epochs, learningRate);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "tuned in " << std::fixed << std::setprecision(1) << seconds << " s on " << threads << " threads" << std::endl;
+
+    if (!tuner.write(out)) {
+        std::cerr << "failed to write " << out << std::endl;
+        return 1;
+    }
+    std::cout << "wrote " << out << std::endl;
+    return 0;
+}